@@ -0,0 +1,456 @@
+#include "autoplayer.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <utility>
+
+#include "thread_pool.hpp"
+#include "transposition_table.hpp"
+#include "zobrist.hpp"
+
+namespace {
+
+using tetromino::board_height;
+using tetromino::board_width;
+
+constexpr double unplayable = -1e9;
+
+int popcount(unsigned int value) {
+    return __builtin_popcount(value);
+}
+
+int count_trailing_zeros(unsigned int value) {
+    return __builtin_ctz(value);
+}
+
+struct Route {
+    int rotation;
+    int x;
+    int y;
+    int turns;      // rotate inputs; counter-clockwise when ccw is set
+    bool ccw;
+    int shift;      // horizontal inputs after rotating
+    int direction;  // -1 left, 1 right
+};
+
+// Rotations are reached the way a player would: up to two clockwise turns,
+// or one counter-clockwise turn for the third orientation. From there the
+// piece is shifted sideways while it fits and then hard dropped.
+template <typename Visit>
+void for_each_placement(const tetromino::RowMasks& board,
+                        const BoardProfile& profile,
+                        const TetrisGame::PiecePose& start,
+                        Visit&& visit) {
+    const int frames = tetromino::pieces[start.type].rotation_count;
+    for (int orientation = 0; orientation < frames; ++orientation) {
+        bool ccw = orientation == 3;
+        int turns = ccw ? 1 : orientation;
+        int rotation = start.rotation;
+        int x = start.x;
+        bool reachable = true;
+        for (int step = 0; step < turns && reachable; ++step) {
+            int next_rotation = tetromino::rotated(start.type, rotation, ccw ? -1 : 1);
+            reachable = tetromino::kick(board, start.type, next_rotation, x, start.y, x);
+            rotation = next_rotation;
+        }
+        if (!reachable) {
+            continue;
+        }
+
+        for (int direction : {-1, 1}) {
+            for (int shift = direction < 0 ? 0 : 1;; ++shift) {
+                int target_x = x + direction * shift;
+                if (!tetromino::fits(board, start.type, rotation, target_x, start.y)) {
+                    break;
+                }
+                int landing_y = profile.drop_y(start.type, rotation, target_x, start.y);
+                if (landing_y < 0) {
+                    landing_y = tetromino::drop_y(board, start.type, rotation, target_x, start.y);
+                }
+                visit(Route{rotation, target_x, landing_y, turns, ccw, shift, direction});
+            }
+        }
+    }
+}
+
+const std::array<std::pair<const char*, double EvalWeights::*>, 5> weight_fields{{
+    {"aggregate_height", &EvalWeights::aggregate_height},
+    {"lines", &EvalWeights::lines},
+    {"holes", &EvalWeights::holes},
+    {"bumpiness", &EvalWeights::bumpiness},
+    {"wells", &EvalWeights::wells},
+}};
+
+std::uint64_t fingerprint(const EvalWeights& weights) {
+    std::uint64_t key = 0;
+    for (const auto& [name, field] : weight_fields) {
+        std::uint64_t bits = 0;
+        std::memcpy(&bits, &(weights.*field), sizeof bits);
+        std::uint64_t state = key ^ bits;
+        key = zobrist::splitmix64(state);
+    }
+    return key;
+}
+
+}  // namespace
+
+bool load_weights(const std::string& path, EvalWeights& out) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+    EvalWeights weights = out;
+    std::string name;
+    double value = 0.0;
+    while (file >> name >> value) {
+        for (const auto& [field_name, field] : weight_fields) {
+            if (name == field_name) {
+                weights.*field = value;
+            }
+        }
+    }
+    if (!file.eof()) {
+        return false;
+    }
+    out = weights;
+    return true;
+}
+
+bool save_weights(const std::string& path, const EvalWeights& weights) {
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+        file.precision(9);
+        for (const auto& [field_name, field] : weight_fields) {
+            file << field_name << ' ' << weights.*field << '\n';
+        }
+        if (!file) {
+            return false;
+        }
+    }
+    return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+Autoplayer::Autoplayer(EvalWeights weights, SearchConfig search, WorkStealingPool* pool)
+    : weights_(weights), search_(search), pool_(pool), weights_key_(fingerprint(weights)) {
+    search_.depth = std::clamp(search_.depth, 1, 3);
+    search_.beam_width = std::max(1, search_.beam_width);
+    std::size_t capacity = static_cast<std::size_t>(search_.beam_width) * MAX_PLACEMENTS;
+    frontier_.reserve(std::max<std::size_t>(capacity, MAX_PLACEMENTS));
+    arenas_.resize(pool_ ? pool_->size() : 1);
+    for (auto& arena : arenas_) {
+        arena.nodes.reserve(capacity);
+    }
+}
+
+void Autoplayer::set_weights(const EvalWeights& weights) {
+    weights_ = weights;
+    weights_key_ = fingerprint(weights);
+}
+
+int Autoplayer::place(tetromino::RowMasks& board, int piece, int rotation, int x, int y, std::uint32_t& full_rows) {
+    const auto& shape = tetromino::shapes[piece][rotation];
+    const auto& masks = shape.shifted[x + tetromino::x_slot_offset];
+    full_rows = 0;
+    for (int dy = shape.top; dy <= shape.bottom; ++dy) {
+        board[y + dy] |= masks[dy];
+        if (board[y + dy] == TetrisGame::FULL_ROW) {
+            full_rows |= 1u << (y + dy);
+        }
+    }
+    if (full_rows == 0) {
+        return 0;
+    }
+
+    int target = y + shape.bottom;
+    for (int row = target; row >= 0; --row) {
+        if (board[row] == TetrisGame::FULL_ROW) {
+            continue;
+        }
+        board[target--] = board[row];
+    }
+    while (target >= 0) {
+        board[target--] = 0;
+    }
+    return popcount(full_rows);
+}
+
+BoardFeatures Autoplayer::measure(const tetromino::RowMasks& board) {
+    BoardFeatures features;
+    std::array<int, board_width> heights{};
+    unsigned int seen = 0;
+    for (int y = 0; y < board_height; ++y) {
+        unsigned int row = board[y];
+        features.holes += popcount(seen & ~row);
+        for (unsigned int fresh = row & ~seen; fresh != 0; fresh &= fresh - 1) {
+            heights[count_trailing_zeros(fresh)] = board_height - y;
+        }
+        seen |= row;
+    }
+
+    for (int col = 0; col < board_width; ++col) {
+        int height = heights[col];
+        features.aggregate_height += height;
+        features.max_height = height > features.max_height ? height : features.max_height;
+        if (col + 1 < board_width) {
+            features.bumpiness += std::abs(height - heights[col + 1]);
+        }
+        int left = col > 0 ? heights[col - 1] : board_height;
+        int right = col + 1 < board_width ? heights[col + 1] : board_height;
+        int rim = left < right ? left : right;
+        if (rim > height) {
+            features.wells += rim - height;
+        }
+    }
+    return features;
+}
+
+double Autoplayer::score(const BoardFeatures& features, int cleared_lines, const EvalWeights& weights) {
+    return weights.aggregate_height * features.aggregate_height + weights.lines * cleared_lines +
+           weights.holes * features.holes + weights.bumpiness * features.bumpiness + weights.wells * features.wells;
+}
+
+bool Autoplayer::plan(const TetrisGame& game, Plan& out) {
+    root_count_ = enumerate_roots(game);
+    if (root_count_ == 0) {
+        return false;
+    }
+
+    int best_root = 0;
+    for (int root = 1; root < root_count_; ++root) {
+        if (root_plans_[root].score > root_plans_[best_root].score) {
+            best_root = root;
+        }
+    }
+
+    if (search_.depth > 1) {
+        next_ = game.next_piece();
+        level_ = 0;
+        for (auto& arena : arenas_) {
+            arena.root_best.fill(-std::numeric_limits<double>::infinity());
+        }
+        collect_frontier();
+        for (int level = 1; level < search_.depth; ++level) {
+            run_level(level);
+            if (level + 1 < search_.depth) {
+                collect_frontier();
+            }
+        }
+
+        double best_value = -std::numeric_limits<double>::infinity();
+        int lookahead_root = -1;
+        for (int root = 0; root < root_count_; ++root) {
+            double value = -std::numeric_limits<double>::infinity();
+            for (const auto& arena : arenas_) {
+                value = std::max(value, arena.root_best[root]);
+            }
+            if (value > best_value) {
+                best_value = value;
+                lookahead_root = root;
+            }
+        }
+        if (lookahead_root >= 0 && best_value > unplayable) {
+            best_root = lookahead_root;
+        }
+    }
+
+    for (auto& arena : arenas_) {
+        placements_evaluated_ += arena.evaluated;
+        table_hits_ += arena.table_hits;
+        arena.evaluated = 0;
+        arena.table_hits = 0;
+    }
+    out = root_plans_[best_root];
+    return true;
+}
+
+int Autoplayer::enumerate_roots(const TetrisGame& game) {
+    const auto& board = game.occupancy();
+    const auto start = game.current_piece();
+    frontier_.clear();
+    if (!tetromino::fits(board, start.type, start.rotation, start.x, start.y)) {
+        return 0;
+    }
+
+    using Action = TetrisGame::Action;
+    const Node root{board, game.profile(), game.hash(), 0, 0, 0.0};
+    int count = 0;
+    if (search_.tucks) {
+        int found = moves_.generate(board, start);
+        for (int index = 0; index < found && count < MAX_PLACEMENTS; ++index) {
+            auto [rotation, x, y] = moves_.placement(index);
+            int length = moves_.path(index, root_plans_[count].actions.data(), MAX_PLAN);
+            if (length < 0) {
+                continue;
+            }
+            add_root(root, count++, start.type, rotation, x, y).size = length;
+        }
+        return count;
+    }
+
+    for_each_placement(board, game.profile(), start, [&](const Route& route) {
+        if (count == MAX_PLACEMENTS) {
+            return;
+        }
+        auto& plan = add_root(root, count++, start.type, route.rotation, route.x, route.y);
+        plan.size = 0;
+        for (int step = 0; step < route.turns; ++step) {
+            plan.push(route.ccw ? Action::RotateCCW : Action::RotateCW);
+        }
+        for (int step = 0; step < route.shift; ++step) {
+            plan.push(route.direction < 0 ? Action::MoveLeft : Action::MoveRight);
+        }
+        plan.push(Action::HardDrop);
+    });
+    return count;
+}
+
+Autoplayer::Plan& Autoplayer::add_root(const Node& start, int index, int piece, int rotation, int x, int y) {
+    Node node = child(start, piece, rotation, x, y, arenas_[0]);
+    node.root = index;
+    frontier_.push_back(node);
+
+    auto& plan = root_plans_[index];
+    plan.rotation = rotation;
+    plan.x = x;
+    plan.y = y;
+    plan.score = node.value;
+    return plan;
+}
+
+void Autoplayer::run_level(int level) {
+    level_ = level;
+    for (auto& arena : arenas_) {
+        arena.nodes.clear();
+    }
+    if (pool_ && frontier_.size() > 1) {
+        pool_->parallel_for(frontier_.size(), 1, [this](std::size_t index, std::size_t worker) {
+            expand(frontier_[index], arenas_[worker]);
+        });
+        return;
+    }
+    for (const auto& node : frontier_) {
+        expand(node, arenas_[0]);
+    }
+}
+
+void Autoplayer::expand(const Node& node, Arena& arena) {
+    auto& best = arena.root_best[node.root];
+    if (level_ > 1) {
+        best = std::max(best, expected_value(node, arena));
+        return;
+    }
+
+    if (!tetromino::fits(node.board, next_.type, next_.rotation, next_.x, next_.y)) {
+        best = std::max(best, unplayable);
+        return;
+    }
+    const bool keep_children = search_.depth > 2;
+    for_each_placement(node.board, node.profile, next_, [&](const Route& route) {
+        Node next = child(node, next_.type, route.rotation, route.x, route.y, arena);
+        if (keep_children) {
+            arena.nodes.push_back(next);
+        } else {
+            best = std::max(best, next.value);
+        }
+    });
+}
+
+// The piece after next is unknown, so the node is worth the average over all
+// piece types of the best placement for each. That average only depends on
+// the stack, so it is computed without the node's lines and cached by hash.
+double Autoplayer::expected_value(const Node& node, Arena& arena) const {
+    const std::uint64_t key = node.hash ^ weights_key_;
+    std::uint64_t cached = 0;
+    double value = 0.0;
+    if (table_ && table_->probe(key, cached)) {
+        arena.table_hits++;
+        std::memcpy(&value, &cached, sizeof value);
+        return value + weights_.lines * node.lines;
+    }
+
+    Node stack = node;
+    stack.lines = 0;
+    for (int type = 0; type < tetromino::piece_types; ++type) {
+        TetrisGame::PiecePose start{type, 0, tetromino::spawn_x, tetromino::spawn_y};
+        if (!tetromino::fits(stack.board, type, 0, start.x, start.y)) {
+            value += unplayable;
+            continue;
+        }
+        double best = unplayable;
+        for_each_placement(stack.board, stack.profile, start, [&](const Route& route) {
+            best = std::max(best, child(stack, type, route.rotation, route.x, route.y, arena).value);
+        });
+        value += best;
+    }
+    value /= tetromino::piece_types;
+
+    if (table_) {
+        std::memcpy(&cached, &value, sizeof cached);
+        if (cached != 0) {
+            table_->store(key, cached);
+        }
+    }
+    return value + weights_.lines * node.lines;
+}
+
+// Places a piece on a copy of the parent. The profile and its features are
+// updated for the columns the piece touched; the hash takes the piece's
+// cells, or is recomputed when rows were cleared and the stack moved.
+Autoplayer::Node Autoplayer::child(const Node& parent, int piece, int rotation, int x, int y, Arena& arena) const {
+    Node node = parent;
+    node.profile.add_piece(piece, rotation, x, y);
+    std::uint32_t full_rows = 0;
+    int cleared = place(node.board, piece, rotation, x, y, full_rows);
+    if (cleared == 0) {
+        node.hash ^= zobrist::piece(piece, rotation, x, y);
+    } else {
+        node.profile.remove_rows(full_rows);
+        node.hash = zobrist::board(node.board);
+    }
+    node.lines += cleared;
+    node.value = score(node.profile.features(), node.lines, weights_);
+    arena.evaluated++;
+    return node;
+}
+
+// Gathers the children produced by every worker and keeps the best
+// beam_width distinct positions. Nodes with the same stack and line count
+// have the same future, so only the best of them is expanded. Ties are
+// broken on content so the result does not depend on how work was split
+// between threads.
+void Autoplayer::collect_frontier() {
+    if (level_ > 0) {
+        frontier_.clear();
+        for (const auto& arena : arenas_) {
+            frontier_.insert(frontier_.end(), arena.nodes.begin(), arena.nodes.end());
+        }
+    }
+    std::sort(frontier_.begin(), frontier_.end(), [](const Node& a, const Node& b) {
+        if (a.value != b.value) {
+            return a.value > b.value;
+        }
+        if (a.root != b.root) {
+            return a.root < b.root;
+        }
+        return a.board < b.board;
+    });
+
+    const auto width = static_cast<std::size_t>(search_.beam_width);
+    std::size_t kept = 0;
+    for (std::size_t index = 0; index < frontier_.size() && kept < width; ++index) {
+        const Node& node = frontier_[index];
+        auto same = [&node](const Node& other) { return other.hash == node.hash && other.lines == node.lines; };
+        if (std::none_of(frontier_.begin(), frontier_.begin() + static_cast<std::ptrdiff_t>(kept), same)) {
+            frontier_[kept++] = node;
+        }
+    }
+    frontier_.resize(kept);
+}
@@ -0,0 +1,279 @@
+#include "board_renderer.hpp"
+
+#include <algorithm>
+
+namespace {
+constexpr std::uint32_t all_rows = (1u << TetrisGame::HEIGHT) - 1;
+}
+
+BoardRenderer::BoardRenderer(const TetrisGame& game, int block_size, bool show_grid)
+    : game_(game), block_size_(block_size), show_grid_(show_grid) {}
+
+BoardRenderer::~BoardRenderer() {
+    drop_settled_surface();
+    drop_sprites();
+}
+
+void BoardRenderer::set_block_size(int block_size) {
+    if (block_size == block_size_) {
+        return;
+    }
+    block_size_ = block_size;
+    drop_settled_surface();
+    drop_sprites();
+}
+
+void BoardRenderer::set_source(cairo_t* cr, const palette::Rgb& color) {
+    cairo_set_source_rgb(cr, color.r / 255.0, color.g / 255.0, color.b / 255.0);
+}
+
+void BoardRenderer::render_board(cairo_t* cr,
+                                 const Area& area,
+                                 const TetrisGame::Cells& active,
+                                 const TetrisGame::Cells& ghost) {
+    render_grid(cr, area, TetrisGame::WIDTH, TetrisGame::HEIGHT, active, ghost, true, show_grid_);
+}
+
+void BoardRenderer::render_preview(cairo_t* cr, const Area& area, const TetrisGame::Cells& cells, int cols, int rows) {
+    render_grid(cr, area, cols, rows, cells, {}, false, false);
+}
+
+void BoardRenderer::fill_background(cairo_t* cr, int width, int height) {
+    set_source(cr, palette::background);
+    cairo_rectangle(cr, 0, 0, width, height);
+    cairo_fill(cr);
+}
+
+// Only cells that intersect `area` are drawn, plus a ring of neighbours
+// whose edge strokes reach into it, so a clipped repaint produces the
+// same pixels as a full one.
+void BoardRenderer::render_grid(cairo_t* cr,
+                                const Area& area,
+                                int cols,
+                                int rows,
+                                const TetrisGame::Cells& overlays,
+                                const TetrisGame::Cells& ghosts,
+                                bool draw_settled,
+                                bool draw_grid) {
+    if (!cr) {
+        return;
+    }
+    auto first_cell = [this](int pixel) { return std::max(0, pixel / block_size_ - 1); };
+    auto last_cell = [this](int pixel, int count) { return std::min(count - 1, pixel / block_size_ + 1); };
+    const int first_x = first_cell(area.x);
+    const int last_x = last_cell(area.x + area.width - 1, cols);
+    const int first_y = first_cell(area.y);
+    const int last_y = last_cell(area.y + area.height - 1, rows);
+    auto in_area = [&](int x, int y) { return x >= first_x && x <= last_x && y >= first_y && y <= last_y; };
+
+    const bool is_clearing = game_.is_clearing();
+    const bool flash_on = game_.flash_visible();
+    const auto& flashing_rows = game_.clearing_rows();
+    auto row_is_flashing = [&](int row) {
+        return std::find(flashing_rows.begin(), flashing_rows.end(), row) != flashing_rows.end();
+    };
+
+    if (draw_settled) {
+        update_settled_surface(cr);
+        cairo_set_source_surface(cr, settled_surface_, -settled_margin_, -settled_margin_);
+        cairo_rectangle(cr,
+                        -settled_margin_,
+                        -settled_margin_,
+                        cols * block_size_ + 2 * settled_margin_,
+                        rows * block_size_ + 2 * settled_margin_);
+        cairo_fill(cr);
+    } else if (draw_grid) {
+        for (int y = first_y; y <= last_y; ++y) {
+            for (int x = first_x; x <= last_x; ++x) {
+                cairo_rectangle(cr, x * block_size_, y * block_size_, block_size_, block_size_);
+            }
+        }
+        set_source(cr, palette::grid);
+        cairo_stroke(cr);
+    }
+
+    for (const auto& cell : ghosts) {
+        if (in_area(cell.x, cell.y)) {
+            draw_ghost_cell(cr, cell.x, cell.y, cell.color);
+        }
+    }
+
+    for (const auto& cell : overlays) {
+        if (in_area(cell.x, cell.y) && !(is_clearing && !flash_on && row_is_flashing(cell.y))) {
+            draw_cell(cr, cell.x, cell.y, cell.color);
+        }
+    }
+}
+
+// Repaints the stale row bands of the settled surface. Each band is
+// clipped one pixel past its rows and redrawn together with the rows on
+// either side, whose strokes reach into it.
+void BoardRenderer::update_settled_surface(cairo_t* target) {
+    if (!settled_surface_) {
+        settled_surface_ = cairo_surface_create_similar(cairo_get_target(target),
+                                                        CAIRO_CONTENT_COLOR,
+                                                        TetrisGame::WIDTH * block_size_ + 2 * settled_margin_,
+                                                        TetrisGame::HEIGHT * block_size_ + 2 * settled_margin_);
+        settled_stale_ = all_rows;
+    }
+    if (settled_stale_ == 0) {
+        return;
+    }
+
+    cairo_t* cr = cairo_create(settled_surface_);
+    cairo_translate(cr, settled_margin_, settled_margin_);
+    for (int row = 0; row < TetrisGame::HEIGHT;) {
+        if ((settled_stale_ & (1u << row)) == 0) {
+            ++row;
+            continue;
+        }
+        int first = row;
+        while (row < TetrisGame::HEIGHT && (settled_stale_ & (1u << row)) != 0) {
+            ++row;
+        }
+        int last = row - 1;
+        cairo_save(cr);
+        cairo_rectangle(cr,
+                        -settled_margin_,
+                        first * block_size_ - settled_margin_,
+                        TetrisGame::WIDTH * block_size_ + 2 * settled_margin_,
+                        (last - first + 1) * block_size_ + 2 * settled_margin_);
+        cairo_clip(cr);
+        set_source(cr, palette::background);
+        cairo_paint(cr);
+        paint_settled(cr, std::max(0, first - 1), std::min(TetrisGame::HEIGHT - 1, last + 1));
+        cairo_restore(cr);
+    }
+    cairo_destroy(cr);
+    settled_stale_ = 0;
+}
+
+// Batched by layer: one stroke for the grid, one fill per color and one
+// stroke for all block borders, however full the stack is.
+void BoardRenderer::paint_settled(cairo_t* cr, int first_row, int last_row) {
+    const bool hide_flashing = game_.is_clearing() && !game_.flash_visible();
+    const auto& flashing_rows = game_.clearing_rows();
+    const auto& settled = game_.board();
+    std::uint32_t visible_rows = 0;
+    unsigned int colors = 0;
+    for (int y = first_row; y <= last_row; ++y) {
+        if (!hide_flashing || std::find(flashing_rows.begin(), flashing_rows.end(), y) == flashing_rows.end()) {
+            visible_rows |= 1u << y;
+        }
+        for (int x = 0; x < TetrisGame::WIDTH; ++x) {
+            colors |= 1u << settled[y][x];
+        }
+    }
+    auto add_blocks = [&](int color) {
+        constexpr double offset = 1.0;
+        for (int y = first_row; y <= last_row; ++y) {
+            if ((visible_rows & (1u << y)) == 0) {
+                continue;
+            }
+            for (int x = 0; x < TetrisGame::WIDTH; ++x) {
+                int cell = settled[y][x];
+                if (cell != 0 && (color < 0 || cell == color)) {
+                    cairo_rectangle(cr,
+                                    x * block_size_ + offset,
+                                    y * block_size_ + offset,
+                                    block_size_ - 2 * offset,
+                                    block_size_ - 2 * offset);
+                }
+            }
+        }
+    };
+
+    if (show_grid_ && (colors & 1u) != 0) {
+        for (int y = first_row; y <= last_row; ++y) {
+            for (int x = 0; x < TetrisGame::WIDTH; ++x) {
+                if (settled[y][x] == 0) {
+                    cairo_rectangle(cr, x * block_size_, y * block_size_, block_size_, block_size_);
+                }
+            }
+        }
+        set_source(cr, palette::grid);
+        cairo_stroke(cr);
+    }
+    if ((colors & ~1u) == 0 || visible_rows == 0) {
+        return;
+    }
+    for (int color = 1; color < static_cast<int>(palette::blocks.size()); ++color) {
+        if ((colors & (1u << color)) != 0) {
+            add_blocks(color);
+            set_source(cr, palette::blocks[color]);
+            cairo_fill(cr);
+        }
+    }
+    add_blocks(-1);
+    set_source(cr, palette::border);
+    cairo_stroke(cr);
+}
+
+void BoardRenderer::drop_settled_surface() {
+    if (settled_surface_) {
+        cairo_surface_destroy(settled_surface_);
+        settled_surface_ = nullptr;
+    }
+}
+
+void BoardRenderer::draw_cell(cairo_t* cr, int x, int y, int color) {
+    draw_sprite(cr, x, y, color, sprite_block_row_);
+}
+
+void BoardRenderer::draw_ghost_cell(cairo_t* cr, int x, int y, int color) {
+    draw_sprite(cr, x, y, color, sprite_ghost_row_);
+}
+
+void BoardRenderer::draw_sprite(cairo_t* cr, int x, int y, int color, int row) {
+    if (color < 0 || color >= static_cast<int>(palette::blocks.size())) {
+        return;
+    }
+    update_sprites(cr);
+    cairo_set_source_surface(cr, sprites_, (x - color) * block_size_, (y - row) * block_size_);
+    cairo_rectangle(cr, x * block_size_, y * block_size_, block_size_, block_size_);
+    cairo_fill(cr);
+}
+
+// One tile per color for blocks and one per color for ghost outlines, at
+// the current block size. Tiles keep an alpha channel so the antialiased
+// edges of their strokes blend with whatever is below, as direct drawing did.
+void BoardRenderer::update_sprites(cairo_t* target) {
+    if (sprites_) {
+        return;
+    }
+    sprites_ = cairo_surface_create_similar(cairo_get_target(target),
+                                            CAIRO_CONTENT_COLOR_ALPHA,
+                                            static_cast<int>(palette::blocks.size()) * block_size_,
+                                            2 * block_size_);
+    cairo_t* cr = cairo_create(sprites_);
+    for (std::size_t color = 0; color < palette::blocks.size(); ++color) {
+        double x = static_cast<double>(color) * block_size_;
+
+        double offset = 1.0;
+        double y = sprite_block_row_ * block_size_;
+        set_source(cr, palette::blocks[color]);
+        cairo_rectangle(cr, x + offset, y + offset, block_size_ - 2 * offset, block_size_ - 2 * offset);
+        cairo_fill(cr);
+        // simple border
+        set_source(cr, palette::border);
+        cairo_rectangle(cr, x + offset, y + offset, block_size_ - 2 * offset, block_size_ - 2 * offset);
+        cairo_stroke(cr);
+
+        offset = 3.0;
+        y = sprite_ghost_row_ * block_size_;
+        cairo_save(cr);
+        set_source(cr, palette::blocks[color]);
+        cairo_set_line_width(cr, 2.0);
+        cairo_rectangle(cr, x + offset, y + offset, block_size_ - 2 * offset, block_size_ - 2 * offset);
+        cairo_stroke(cr);
+        cairo_restore(cr);
+    }
+    cairo_destroy(cr);
+}
+
+void BoardRenderer::drop_sprites() {
+    if (sprites_) {
+        cairo_surface_destroy(sprites_);
+        sprites_ = nullptr;
+    }
+}
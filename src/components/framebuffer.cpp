@@ -0,0 +1,135 @@
+#include "framebuffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/fb.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+// fb_var_screeninfo::grayscale value of the Kindle mxcfb driver for 8-bit
+// panels that store 0 as white.
+constexpr std::uint32_t grayscale_8bit_inverted = 2;
+}  // namespace
+
+Framebuffer::~Framebuffer() {
+    close();
+}
+
+bool Framebuffer::open_device(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    fb_var_screeninfo var{};
+    fb_fix_screeninfo fix{};
+    if (ioctl(fd, FBIOGET_VSCREENINFO, &var) != 0 || ioctl(fd, FBIOGET_FSCREENINFO, &fix) != 0) {
+        ::close(fd);
+        return false;
+    }
+    Format format;
+    if (var.bits_per_pixel == 8) {
+        format = Format::Gray8;
+    } else if (var.bits_per_pixel == 16 && var.red.length == 5 && var.green.length == 6 && var.blue.length == 5) {
+        format = Format::Rgb565;
+    } else {
+        ::close(fd);
+        return false;
+    }
+    // The visible screen starts at the panning offset inside the buffer.
+    std::size_t offset = static_cast<std::size_t>(var.yoffset) * fix.line_length + var.xoffset * var.bits_per_pixel / 8;
+    std::size_t visible = static_cast<std::size_t>(fix.line_length) * var.yres;
+    if (var.xres == 0 || var.yres == 0 || offset + visible > fix.smem_len || !map(fd, fix.smem_len)) {
+        ::close(fd);
+        return false;
+    }
+    pixels_ += offset;
+    width_ = static_cast<int>(var.xres);
+    height_ = static_cast<int>(var.yres);
+    stride_ = static_cast<int>(fix.line_length);
+    format_ = format;
+    inverted_ = format == Format::Gray8 && var.grayscale == grayscale_8bit_inverted;
+    return true;
+}
+
+bool Framebuffer::open_file(const std::string& path, int width, int height, Format format) {
+    close();
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    int stride = format == Format::Gray8 ? width : 2 * width;
+    std::size_t size = static_cast<std::size_t>(stride) * height;
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0 || !map(fd, size)) {
+        ::close(fd);
+        return false;
+    }
+    width_ = width;
+    height_ = height;
+    stride_ = stride;
+    format_ = format;
+    inverted_ = false;
+    return true;
+}
+
+void Framebuffer::close() {
+    if (mapping_) {
+        munmap(mapping_, mapping_size_);
+        mapping_ = nullptr;
+        mapping_size_ = 0;
+        pixels_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    width_ = 0;
+    height_ = 0;
+    stride_ = 0;
+}
+
+bool Framebuffer::map(int fd, std::size_t size) {
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    fd_ = fd;
+    mapping_ = mapping;
+    mapping_size_ = size;
+    pixels_ = static_cast<std::uint8_t*>(mapping);
+    return true;
+}
+
+std::uint16_t Framebuffer::pixel(const palette::Rgb& color) const {
+    if (format_ == Format::Rgb565) {
+        return static_cast<std::uint16_t>(((color.r >> 3) << 11) | ((color.g >> 2) << 5) | (color.b >> 3));
+    }
+    // BT.601 luma in 8.8 fixed point
+    int luma = (77 * color.r + 150 * color.g + 29 * color.b) >> 8;
+    return static_cast<std::uint16_t>(inverted_ ? 255 - luma : luma);
+}
+
+void Framebuffer::fill(int x, int y, int width, int height, std::uint16_t pixel) {
+    int left = std::max(x, 0);
+    int top = std::max(y, 0);
+    int right = std::min(x + width, width_);
+    int bottom = std::min(y + height, height_);
+    if (!pixels_ || left >= right || top >= bottom) {
+        return;
+    }
+    for (int row = top; row < bottom; ++row) {
+        std::uint8_t* line = pixels_ + static_cast<std::size_t>(row) * stride_;
+        if (format_ == Format::Gray8) {
+            std::memset(line + left, pixel, static_cast<std::size_t>(right - left));
+        } else {
+            auto* words = reinterpret_cast<std::uint16_t*>(line);
+            std::fill(words + left, words + right, pixel);
+        }
+    }
+}
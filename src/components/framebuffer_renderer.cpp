@@ -0,0 +1,112 @@
+#include "framebuffer_renderer.hpp"
+
+#include <algorithm>
+
+FramebufferRenderer::FramebufferRenderer(const TetrisGame& game,
+                                         Framebuffer& framebuffer,
+                                         int block_size,
+                                         int origin_x,
+                                         int origin_y)
+    : game_(game),
+      framebuffer_(framebuffer),
+      block_size_(block_size),
+      origin_x_(origin_x),
+      origin_y_(origin_y),
+      background_(framebuffer.pixel(palette::background)),
+      grid_(framebuffer.pixel(palette::grid)),
+      border_(framebuffer.pixel(palette::border)) {
+    for (std::size_t color = 0; color < palette::blocks.size(); ++color) {
+        blocks_[color] = framebuffer.pixel(palette::blocks[color]);
+    }
+    invalidate();
+}
+
+void FramebufferRenderer::invalidate() {
+    for (auto& row : painted_) {
+        row.fill(unpainted_);
+    }
+}
+
+FramebufferRenderer::Rect FramebufferRenderer::render() {
+    std::array<std::array<Look, TetrisGame::WIDTH>, TetrisGame::HEIGHT> looks{};
+    const bool hide_flashing = game_.is_clearing() && !game_.flash_visible();
+    const auto& flashing_rows = game_.clearing_rows();
+    auto visible = [&](int row) {
+        return !hide_flashing || std::find(flashing_rows.begin(), flashing_rows.end(), row) == flashing_rows.end();
+    };
+    auto on_board = [](const TetrisGame::Cell& cell) {
+        return cell.x >= 0 && cell.x < TetrisGame::WIDTH && cell.y >= 0 && cell.y < TetrisGame::HEIGHT;
+    };
+    const auto& settled = game_.board();
+    for (int y = 0; y < TetrisGame::HEIGHT; ++y) {
+        if (visible(y)) {
+            for (int x = 0; x < TetrisGame::WIDTH; ++x) {
+                looks[y][x] = settled[y][x];
+            }
+        }
+    }
+    if (game_.is_running()) {
+        for (const auto& cell : game_.ghost_cells()) {
+            if (on_board(cell)) {
+                looks[cell.y][cell.x] = static_cast<Look>(cell.color | ghost_look_);
+            }
+        }
+    }
+    for (const auto& cell : game_.active_cells()) {
+        if (on_board(cell) && visible(cell.y)) {
+            looks[cell.y][cell.x] = static_cast<Look>(cell.color);
+        }
+    }
+
+    int first_x = TetrisGame::WIDTH;
+    int last_x = -1;
+    int first_y = TetrisGame::HEIGHT;
+    int last_y = -1;
+    for (int y = 0; y < TetrisGame::HEIGHT; ++y) {
+        for (int x = 0; x < TetrisGame::WIDTH; ++x) {
+            if (looks[y][x] == painted_[y][x]) {
+                continue;
+            }
+            draw_cell(x, y, looks[y][x]);
+            painted_[y][x] = looks[y][x];
+            first_x = std::min(first_x, x);
+            last_x = std::max(last_x, x);
+            first_y = std::min(first_y, y);
+            last_y = y;
+        }
+    }
+    if (last_y < 0) {
+        return {};
+    }
+    return {origin_x_ + first_x * block_size_,
+            origin_y_ + first_y * block_size_,
+            (last_x - first_x + 1) * block_size_,
+            (last_y - first_y + 1) * block_size_};
+}
+
+// Matches the cairo drawing at whole pixels: the one-pixel block border
+// sits one pixel in, the two-pixel ghost outline two pixels in.
+void FramebufferRenderer::draw_cell(int x, int y, Look look) {
+    const int left = origin_x_ + x * block_size_;
+    const int top = origin_y_ + y * block_size_;
+    const int color = look & ~ghost_look_;
+    framebuffer_.fill(left, top, block_size_, block_size_, background_);
+    if (look == 0) {
+        outline(left, top, block_size_, 1, grid_);
+    } else if ((look & ghost_look_) != 0) {
+        outline(left + 2, top + 2, block_size_ - 4, 2, blocks_[color]);
+    } else {
+        outline(left + 1, top + 1, block_size_ - 2, 1, border_);
+        framebuffer_.fill(left + 2, top + 2, block_size_ - 4, block_size_ - 4, blocks_[color]);
+    }
+}
+
+void FramebufferRenderer::outline(int x, int y, int size, int thickness, std::uint16_t pixel) {
+    if (size <= 0) {
+        return;
+    }
+    framebuffer_.fill(x, y, size, thickness, pixel);
+    framebuffer_.fill(x, y + size - thickness, size, thickness, pixel);
+    framebuffer_.fill(x, y, thickness, size, pixel);
+    framebuffer_.fill(x + size - thickness, y, thickness, size, pixel);
+}
@@ -0,0 +1,81 @@
+#include "input_latency.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+
+#include "latency_histogram.hpp"
+
+namespace {
+
+LatencyHistogram histogram;
+// Inputs not painted yet, oldest first; the first queued_count of them
+// have had their cells invalidated. More than fit between two paints are
+// dropped rather than stored.
+std::array<input_latency::TimePoint, 32> waiting{};
+std::size_t waiting_count = 0;
+std::size_t queued_count = 0;
+
+double ms(std::uint64_t micros) {
+    return static_cast<double>(micros) / 1000.0;
+}
+
+}  // namespace
+
+namespace input_latency {
+
+void input(TimePoint pressed_at) {
+    if (waiting_count < waiting.size()) {
+        waiting[waiting_count++] = pressed_at;
+    }
+}
+
+void queued() {
+    queued_count = waiting_count;
+}
+
+void painted() {
+    if (queued_count == 0) {
+        return;
+    }
+    const TimePoint now = Clock::now();
+    for (std::size_t i = 0; i < queued_count; ++i) {
+        histogram.record(std::chrono::duration_cast<std::chrono::microseconds>(now - waiting[i]).count());
+    }
+    std::copy(waiting.begin() + queued_count, waiting.begin() + waiting_count, waiting.begin());
+    waiting_count -= queued_count;
+    queued_count = 0;
+}
+
+void report() {
+    if (histogram.total() == 0) {
+        return;
+    }
+    std::fprintf(stderr,
+                 "input latency: %llu samples, mean %.2f ms, max %.2f ms\n",
+                 static_cast<unsigned long long>(histogram.total()),
+                 histogram.mean() / 1000.0,
+                 ms(histogram.max()));
+    std::fprintf(stderr,
+                 "  p50 %.2f  p90 %.2f  p99 %.2f  p99.9 %.2f ms\n",
+                 ms(histogram.percentile(0.5)),
+                 ms(histogram.percentile(0.9)),
+                 ms(histogram.percentile(0.99)),
+                 ms(histogram.percentile(0.999)));
+    std::fprintf(stderr, "  %12s %10s %8s\n", "up to (ms)", "percentile", "count");
+    std::uint64_t seen = 0;
+    for (int bucket = 0; bucket < LatencyHistogram::bucket_count; ++bucket) {
+        std::uint64_t count = histogram.count(bucket);
+        if (count == 0) {
+            continue;
+        }
+        seen += count;
+        std::fprintf(stderr,
+                     "  %12.3f %9.3f%% %8llu\n",
+                     ms(LatencyHistogram::upper_bound(bucket)),
+                     100.0 * static_cast<double>(seen) / static_cast<double>(histogram.total()),
+                     static_cast<unsigned long long>(count));
+    }
+}
+
+}  // namespace input_latency
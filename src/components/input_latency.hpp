@@ -0,0 +1,19 @@
+#pragma once
+
+#include <chrono>
+
+// Input-to-pixel latency: the time from a key press or button click to the
+// end of the first board paint after its change was invalidated, collected
+// into a histogram that report() prints. Only inputs that changed the game
+// are counted, since the others never reach the screen.
+namespace input_latency {
+
+using Clock = std::chrono::steady_clock;
+using TimePoint = Clock::time_point;
+
+void input(TimePoint pressed_at);  // an input that changed the game
+void queued();                     // the board area showing the waiting inputs was invalidated
+void painted();                    // the board was painted; completes the inputs queued before it
+void report();                     // prints the histogram to stderr, if anything was recorded
+
+}  // namespace input_latency
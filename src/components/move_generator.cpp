@@ -0,0 +1,79 @@
+#include "move_generator.hpp"
+
+int MoveGenerator::generate(const tetromino::RowMasks& board, const TetrisGame::PiecePose& start) {
+    using Action = TetrisGame::Action;
+    visited_.fill(0);
+    placement_count_ = 0;
+    if (!tetromino::fits(board, start.type, start.rotation, start.x, start.y)) {
+        return 0;
+    }
+
+    int head = 0;
+    int tail = 0;
+    auto visit = [&](int from, Action via, int rotation, int x, int y) {
+        int state = encode(rotation, x, y);
+        std::uint64_t bit = std::uint64_t{1} << (state % 64);
+        if ((visited_[state / 64] & bit) != 0) {
+            return;
+        }
+        visited_[state / 64] |= bit;
+        parent_[state] = static_cast<std::uint16_t>(from);
+        via_[state] = via;
+        queue_[tail++] = static_cast<std::uint16_t>(state);
+    };
+
+    const int piece = start.type;
+    const bool rotates = tetromino::pieces[piece].rotation_count > 1;
+    visit(no_parent, Action::HardDrop, start.rotation, start.x, start.y);
+    while (head < tail) {
+        int state = queue_[head++];
+        auto [rotation, x, y] = decode(state);
+        if (!tetromino::fits(board, piece, rotation, x, y + 1)) {
+            placements_[placement_count_++] = static_cast<std::uint16_t>(state);
+        } else {
+            visit(state, Action::SoftDrop, rotation, x, y + 1);
+        }
+        if (tetromino::fits(board, piece, rotation, x - 1, y)) {
+            visit(state, Action::MoveLeft, rotation, x - 1, y);
+        }
+        if (tetromino::fits(board, piece, rotation, x + 1, y)) {
+            visit(state, Action::MoveRight, rotation, x + 1, y);
+        }
+        if (rotates) {
+            for (int delta : {1, -1}) {
+                int next_rotation = tetromino::rotated(piece, rotation, delta);
+                int kicked_x = x;
+                if (tetromino::kick(board, piece, next_rotation, x, y, kicked_x)) {
+                    visit(state, delta > 0 ? Action::RotateCW : Action::RotateCCW, next_rotation, kicked_x, y);
+                }
+            }
+        }
+    }
+    return placement_count_;
+}
+
+MoveGenerator::Placement MoveGenerator::placement(int index) const {
+    return decode(placements_[index]);
+}
+
+// Soft drops at the end of the path are replaced by the hard drop, which
+// lands in the same place.
+int MoveGenerator::path(int index, TetrisGame::Action* out, int capacity) const {
+    int state = placements_[index];
+    while (parent_[state] != no_parent && via_[state] == TetrisGame::Action::SoftDrop) {
+        state = parent_[state];
+    }
+    int length = 0;
+    for (int walk = state; parent_[walk] != no_parent; walk = parent_[walk]) {
+        ++length;
+    }
+    if (length + 1 > capacity) {
+        return -1;
+    }
+    out[length] = TetrisGame::Action::HardDrop;
+    for (int step = length - 1; step >= 0; --step) {
+        out[step] = via_[state];
+        state = parent_[state];
+    }
+    return length + 1;
+}
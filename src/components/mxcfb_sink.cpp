@@ -0,0 +1,123 @@
+#include "mxcfb_sink.hpp"
+
+#include <chrono>
+#include <sys/ioctl.h>
+
+namespace {
+
+// Kindle's mxcfb.h is not shipped with the kernel headers, so the parts
+// used here are declared locally, in the layout of the target device.
+namespace mxcfb {
+
+struct Rect {
+    std::uint32_t top;
+    std::uint32_t left;
+    std::uint32_t width;
+    std::uint32_t height;
+};
+
+struct AltBufferData {
+    std::uint32_t phys_addr;
+    std::uint32_t width;
+    std::uint32_t height;
+    Rect alt_update_region;
+};
+
+#if defined(TETRIS_MXCFB_PEARL)
+// PW2, PW3, Voyage and the first Oasis
+struct UpdateData {
+    Rect update_region;
+    std::uint32_t waveform_mode;
+    std::uint32_t update_mode;
+    std::uint32_t update_marker;
+    std::uint32_t hist_bw_waveform_mode;
+    std::uint32_t hist_gray_waveform_mode;
+    std::int32_t temp;
+    std::uint32_t flags;
+    AltBufferData alt_buffer_data;
+};
+#elif defined(TETRIS_MXCFB_REX) || defined(TETRIS_MXCFB_ZELDA)
+// Rex: PW4 and the Kindle 10; Zelda: Oasis 2 and 3, which add the timestamps
+struct UpdateData {
+    Rect update_region;
+    std::uint32_t waveform_mode;
+    std::uint32_t update_mode;
+    std::uint32_t update_marker;
+    std::int32_t temp;
+    std::uint32_t flags;
+    std::int32_t dither_mode;
+    std::int32_t quant_bit;
+    AltBufferData alt_buffer_data;
+    std::uint32_t hist_bw_waveform_mode;
+    std::uint32_t hist_gray_waveform_mode;
+#if defined(TETRIS_MXCFB_ZELDA)
+    std::uint32_t ts_pxp;
+    std::uint32_t ts_epdc;
+#endif
+};
+#else
+#error "mxcfb_sink.cpp needs TETRIS_MXCFB_PEARL, TETRIS_MXCFB_REX or TETRIS_MXCFB_ZELDA (the mxcfb_layout option)"
+#endif
+
+struct UpdateMarkerData {
+    std::uint32_t update_marker;
+    std::uint32_t collision_test;
+};
+
+constexpr unsigned long send_update = _IOW('F', 0x2E, UpdateData);
+constexpr unsigned long wait_for_update_complete = _IOWR('F', 0x2F, UpdateMarkerData);
+
+constexpr std::uint32_t update_mode_partial = 0;
+constexpr std::uint32_t update_mode_full = 1;
+constexpr std::uint32_t waveform_gc16 = 2;  // flashing 16-level grayscale
+constexpr std::uint32_t waveform_a2 = 4;    // fast black and white
+constexpr std::uint32_t waveform_gl16 = 5;  // 16-level grayscale without the flash
+constexpr std::int32_t temp_use_ambient = 0x1000;
+
+}  // namespace mxcfb
+
+}  // namespace
+
+MxcfbSink::MxcfbSink(int fd, bool wait_for_completion) : fd_(fd), wait_(wait_for_completion) {}
+
+void MxcfbSink::refresh(const Framebuffer::Rect& area, RefreshMode mode) {
+    mxcfb::UpdateData update{};
+    update.update_region = {static_cast<std::uint32_t>(area.y),
+                            static_cast<std::uint32_t>(area.x),
+                            static_cast<std::uint32_t>(area.width),
+                            static_cast<std::uint32_t>(area.height)};
+    switch (mode) {
+        case RefreshMode::Fast:
+            update.waveform_mode = mxcfb::waveform_a2;
+            update.update_mode = mxcfb::update_mode_partial;
+            break;
+        case RefreshMode::Partial:
+            update.waveform_mode = mxcfb::waveform_gl16;
+            update.update_mode = mxcfb::update_mode_partial;
+            break;
+        case RefreshMode::Full:
+            update.waveform_mode = mxcfb::waveform_gc16;
+            update.update_mode = mxcfb::update_mode_full;
+            break;
+    }
+    // 0 means no marker to the driver
+    marker_ = marker_ == UINT32_MAX ? 1 : marker_ + 1;
+    update.update_marker = marker_;
+    update.temp = mxcfb::temp_use_ambient;
+
+    const auto begin = std::chrono::steady_clock::now();
+    if (ioctl(fd_, mxcfb::send_update, &update) != 0) {
+        failures_++;
+        return;
+    }
+    if (!wait_) {
+        return;
+    }
+    mxcfb::UpdateMarkerData marker{marker_, 0};
+    if (ioctl(fd_, mxcfb::wait_for_update_complete, &marker) < 0) {
+        failures_++;
+        return;
+    }
+    waits_.record(static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count()));
+}
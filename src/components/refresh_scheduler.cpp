@@ -0,0 +1,117 @@
+#include "refresh_scheduler.hpp"
+
+#include <algorithm>
+
+namespace {
+
+using Rect = Framebuffer::Rect;
+
+bool is_empty(const Rect& rect) {
+    return rect.width <= 0 || rect.height <= 0;
+}
+
+Rect unite(const Rect& a, const Rect& b) {
+    if (is_empty(a)) {
+        return b;
+    }
+    if (is_empty(b)) {
+        return a;
+    }
+    int left = std::min(a.x, b.x);
+    int top = std::min(a.y, b.y);
+    int right = std::max(a.x + a.width, b.x + b.width);
+    int bottom = std::max(a.y + a.height, b.y + b.height);
+    return {left, top, right - left, bottom - top};
+}
+
+Rect intersect(const Rect& a, const Rect& b) {
+    int left = std::max(a.x, b.x);
+    int top = std::max(a.y, b.y);
+    int right = std::min(a.x + a.width, b.x + b.width);
+    int bottom = std::min(a.y + a.height, b.y + b.height);
+    if (left >= right || top >= bottom) {
+        return {};
+    }
+    return {left, top, right - left, bottom - top};
+}
+
+long long area_of(const Rect& rect) {
+    return is_empty(rect) ? 0 : static_cast<long long>(rect.width) * rect.height;
+}
+
+}  // namespace
+
+RefreshScheduler::RefreshScheduler(DisplaySink& sink, const Framebuffer::Rect& screen, const RefreshPolicy& policy)
+    : sink_(sink), screen_(screen), policy_(policy) {}
+
+void RefreshScheduler::damage(const Framebuffer::Rect& area, Damage kind) {
+    Rect visible = intersect(area, screen_);
+    switch (kind) {
+        case Damage::Normal:
+            pending_ = unite(pending_, visible);
+            break;
+        case Damage::Animation:
+            animation_ = unite(animation_, visible);
+            break;
+        case Damage::Bulk:
+            pending_ = unite(pending_, visible);
+            bulk_ = true;
+            break;
+    }
+}
+
+// A frame with only animation in it goes out with the fast waveform; any
+// other change takes the frame, and any held back animation, to a partial
+// refresh, unless one of the policy's escalations applies.
+void RefreshScheduler::flush() {
+    if (!policy_.animate_clears) {
+        deferred_ = unite(deferred_, animation_);
+        animation_ = {};
+    }
+    const bool changed = !is_empty(pending_) || bulk_;
+    if (!changed && is_empty(animation_)) {
+        return;
+    }
+
+    Rect area = animation_;
+    RefreshMode mode = RefreshMode::Fast;
+    if (changed) {
+        area = unite(unite(pending_, area), deferred_);
+        mode = RefreshMode::Partial;
+    }
+    const bool escalate = (bulk_ && policy_.full_after_bulk) ||
+                          (policy_.full_every > 0 && since_full_ >= policy_.full_every) ||
+                          area_of(area) * 100 >= area_of(screen_) * policy_.full_area_percent;
+    if (escalate) {
+        area = screen_;
+        mode = RefreshMode::Full;
+        deferred_ = {};
+    } else if (changed) {
+        deferred_ = {};
+    }
+    pending_ = {};
+    animation_ = {};
+    bulk_ = false;
+    if (!is_empty(area)) {
+        send(area, mode);
+    }
+}
+
+void RefreshScheduler::send(const Framebuffer::Rect& area, RefreshMode mode) {
+    sink_.refresh(area, mode);
+    stats_.pixels += area_of(area);
+    switch (mode) {
+        case RefreshMode::Fast:
+            stats_.fast++;
+            since_full_++;
+            break;
+        case RefreshMode::Partial:
+            stats_.partials++;
+            since_full_++;
+            break;
+        case RefreshMode::Full:
+            stats_.fulls++;
+            since_full_ = 0;
+            break;
+    }
+}
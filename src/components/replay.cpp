@@ -0,0 +1,183 @@
+#include "replay.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+void write_varint(std::vector<std::uint8_t>& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+bool read_varint(const std::uint8_t*& cursor, const std::uint8_t* end, std::uint64_t& value) {
+    value = 0;
+    for (unsigned int shift = 0; shift < 64 && cursor != end; shift += 7) {
+        std::uint8_t byte = *cursor++;
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+void ReplayRecorder::begin(std::uint32_t seed) {
+    active_ = true;
+    seed_ = seed;
+    pending_ticks_ = 0;
+    records_ = 0;
+    events_.clear();
+}
+
+void ReplayRecorder::record_action(TetrisGame::Action action) {
+    if (!active_) {
+        return;
+    }
+    write_varint(events_, (pending_ticks_ << replay_format::kind_bits) | static_cast<std::uint64_t>(action));
+    pending_ticks_ = 0;
+    records_++;
+}
+
+std::vector<std::uint8_t> ReplayRecorder::encode(const TetrisGame& game) const {
+    std::vector<std::uint8_t> out;
+    out.reserve(events_.size() + 32);
+    for (std::uint8_t byte : replay_format::magic) {
+        out.push_back(byte);
+    }
+    out.push_back(replay_format::version);
+    write_varint(out, seed_);
+    write_varint(out, static_cast<std::uint64_t>(game.score()));
+    write_varint(out, static_cast<std::uint64_t>(game.lines()));
+    write_varint(out, game.is_clearing() ? replay_format::flag_ends_clearing : 0);
+    write_varint(out, records_ + (pending_ticks_ > 0 ? 1 : 0));
+    out.insert(out.end(), events_.begin(), events_.end());
+    if (pending_ticks_ > 0) {
+        write_varint(out, (pending_ticks_ << replay_format::kind_bits) | replay_format::kind_ticks_only);
+    }
+    return out;
+}
+
+bool ReplayRecorder::save(const std::string& path, const TetrisGame& game) const {
+    if (!active_) {
+        return false;
+    }
+    auto bytes = encode(game);
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        if (!file) {
+            return false;
+        }
+    }
+    return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+bool parse_replay(const std::uint8_t* data, std::size_t size, Replay& out) {
+    const std::uint8_t* cursor = data;
+    const std::uint8_t* end = data + size;
+    if (size < sizeof(replay_format::magic) + 1 ||
+        !std::equal(std::begin(replay_format::magic), std::end(replay_format::magic), cursor)) {
+        return false;
+    }
+    cursor += sizeof(replay_format::magic);
+    if (*cursor++ != replay_format::version) {
+        return false;
+    }
+
+    std::uint64_t seed = 0;
+    std::uint64_t score = 0;
+    std::uint64_t lines = 0;
+    std::uint64_t flags = 0;
+    std::uint64_t records = 0;
+    if (!read_varint(cursor, end, seed) || !read_varint(cursor, end, score) || !read_varint(cursor, end, lines) ||
+        !read_varint(cursor, end, flags) || !read_varint(cursor, end, records)) {
+        return false;
+    }
+    out.seed = static_cast<std::uint32_t>(seed);
+    out.score = static_cast<long>(score);
+    out.lines = static_cast<int>(lines);
+    out.ends_clearing = (flags & replay_format::flag_ends_clearing) != 0;
+    // Every record takes at least one byte.
+    if (records > static_cast<std::uint64_t>(end - cursor)) {
+        return false;
+    }
+    out.records = static_cast<std::uint32_t>(records);
+    out.events.assign(cursor, end);
+    return true;
+}
+
+bool load_replay(const std::string& path, Replay& out) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return parse_replay(bytes.data(), bytes.size(), out);
+}
+
+ReplayResult ReplayPlayer::play(const Replay& replay) {
+    ReplayResult result;
+    game_.start(replay.seed);
+
+    // Ticks and actions are only recorded while the game runs, so a record
+    // that reaches past game over asks for more than a game can use and the
+    // replay is corrupt; stopping there also bounds playback of bad files.
+    const std::uint8_t* cursor = replay.events.data();
+    const std::uint8_t* end = cursor + replay.events.size();
+    if (replay.records > replay.events.size()) {
+        return result;
+    }
+    for (std::uint32_t i = 0; i < replay.records; ++i) {
+        std::uint64_t record = 0;
+        if (!read_varint(cursor, end, record) || game_.is_game_over()) {
+            return result;
+        }
+        for (std::uint64_t ticks = record >> replay_format::kind_bits; ticks > 0; --ticks) {
+            settle();
+            if (game_.is_game_over()) {
+                return result;
+            }
+            (void)game_.tick();
+            result.ticks++;
+        }
+        auto kind = static_cast<unsigned int>(record & ((1u << replay_format::kind_bits) - 1));
+        if (kind == replay_format::kind_ticks_only) {
+            continue;
+        }
+        if (kind > static_cast<unsigned int>(TetrisGame::Action::RotateCCW)) {
+            return result;
+        }
+        settle();
+        (void)game_.perform_action(static_cast<TetrisGame::Action>(kind));
+        result.actions++;
+    }
+    if (!replay.ends_clearing) {
+        settle();
+    }
+
+    result.score = game_.score();
+    result.lines = game_.lines();
+    result.matched = cursor == end && result.score == replay.score && result.lines == replay.lines;
+    return result;
+}
+
+// Line clears only block input, so they can be completed as soon as the
+// next recorded event needs the board.
+void ReplayPlayer::settle() {
+    while (game_.is_clearing()) {
+        clock_.advance(TetrisGame::clear_duration());
+        (void)game_.step_clear_animation();
+    }
+}
@@ -0,0 +1,36 @@
+#include "snapshot.hpp"
+
+#include <cstdio>
+#include <fstream>
+
+bool save_snapshot(const std::string& path, const TetrisGame& game) {
+    TetrisGame::Snapshot bytes{};
+    if (!game.snapshot(bytes)) {
+        return false;
+    }
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        if (!file) {
+            return false;
+        }
+    }
+    return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+bool load_snapshot(const std::string& path, TetrisGame& game) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    TetrisGame::Snapshot bytes{};
+    file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (file.gcount() != static_cast<std::streamsize>(bytes.size()) || file.peek() != std::ifstream::traits_type::eof()) {
+        return false;
+    }
+    return game.restore(bytes);
+}
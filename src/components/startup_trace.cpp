@@ -0,0 +1,67 @@
+#include "startup_trace.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Mark {
+    const char* label;
+    Clock::time_point at;
+};
+
+bool enabled = false;
+Clock::time_point started{};
+std::array<Mark, 16> marks{};
+std::size_t mark_count = 0;
+
+double ms_between(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+}  // namespace
+
+namespace startup_trace {
+
+void begin() {
+    const char* value = std::getenv("TETRIS_TRACE_STARTUP");
+    enabled = value != nullptr && *value != '\0' && std::strcmp(value, "0") != 0;
+    started = Clock::now();
+    mark_count = 0;
+}
+
+void mark(const char* label) {
+    if (!enabled || mark_count == marks.size()) {
+        return;
+    }
+    for (std::size_t i = 0; i < mark_count; ++i) {
+        if (std::strcmp(marks[i].label, label) == 0) {
+            return;
+        }
+    }
+    marks[mark_count++] = {label, Clock::now()};
+}
+
+void report() {
+    if (!enabled) {
+        return;
+    }
+    enabled = false;
+    std::fprintf(stderr, "startup trace (ms since main):\n");
+    Clock::time_point previous = started;
+    for (std::size_t i = 0; i < mark_count; ++i) {
+        std::fprintf(stderr,
+                     "  %-28s %8.2f  (+%.2f)\n",
+                     marks[i].label,
+                     ms_between(started, marks[i].at),
+                     ms_between(previous, marks[i].at));
+        previous = marks[i].at;
+    }
+}
+
+}  // namespace startup_trace
@@ -0,0 +1,13 @@
+#pragma once
+
+// Timeline from main() to the first painted board, enabled by setting
+// TETRIS_TRACE_STARTUP. Each mark records the time since begin(); a label
+// is only recorded the first time it is marked. Marks cost one branch
+// when tracing is off.
+namespace startup_trace {
+
+void begin();
+void mark(const char* label);
+void report();  // prints the marks to stderr and turns tracing off
+
+}  // namespace startup_trace
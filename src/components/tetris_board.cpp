@@ -3,6 +3,8 @@
 #include <algorithm>
 #include <iostream>
 
+#include "input_latency.hpp"
+
 namespace {
 
 class CairoContext {
@@ -28,6 +30,32 @@ private:
     cairo_t* cr_ = nullptr;
 };
 
+// Cairo context limited to the exposed region, plus the region's bounding box.
+class ExposeContext : public CairoContext {
+public:
+    ExposeContext(GtkWidget* widget, GdkEventExpose* event) : CairoContext(widget) {
+        if (event) {
+            area_ = event->area;
+            if (get()) {
+                gdk_cairo_region(get(), event->region);
+                cairo_clip(get());
+            }
+        } else if (widget) {
+            gtk_widget_get_allocation(widget, &area_);
+            area_.x = 0;
+            area_.y = 0;
+        }
+    }
+
+    const GdkRectangle& area() const { return area_; }
+
+private:
+    GdkRectangle area_{};
+};
+
+constexpr std::uint16_t all_columns = (1u << TetrisGame::WIDTH) - 1;
+constexpr std::uint32_t all_rows = (1u << TetrisGame::HEIGHT) - 1;
+
 }  // namespace
 
 TetrisBoard::TetrisBoard(TetrisGame& game, int block_size, bool show_grid)
@@ -35,8 +63,7 @@ TetrisBoard::TetrisBoard(TetrisGame& game, int block_size, bool show_grid)
       board_widget_(nullptr),
       next_widget_(nullptr),
       block_size_(std::max(16, block_size)),
-      show_grid_(show_grid) {
-    initialize_color_cache();
+      renderer_(game, block_size_, show_grid) {
     setup_widgets();
 }
 
@@ -52,6 +79,107 @@ void TetrisBoard::queue_next_draw() {
     }
 }
 
+void TetrisBoard::invalidate(const GameEvent& event) {
+    switch (event.type) {
+        case GameEvent::Type::PieceLocked: {
+            renderer_.mark_settled_stale(event.rows);
+            TetrisGame::Cells cells;
+            for (const auto& coord : tetromino::pieces[event.piece.type].rotations[event.piece.rotation]) {
+                cells.push_back({event.piece.x + coord.x, event.piece.y + coord.y, 0});
+            }
+            mark_cells(cells);
+            break;
+        }
+        case GameEvent::Type::RowsCleared: {
+            // Everything from the old top of the stack down to the lowest
+            // cleared row moved.
+            int lowest = 31 - __builtin_clz(event.rows);
+            int cleared = __builtin_popcount(event.rows);
+            int top = std::max(0, TetrisGame::HEIGHT - game_.profile().features().max_height - cleared);
+            for (int row = top; row <= lowest; ++row) {
+                dirty_[row] = all_columns;
+                renderer_.mark_settled_stale(1u << row);
+            }
+            break;
+        }
+        case GameEvent::Type::FlashToggled:
+        case GameEvent::Type::BoardFilled:
+            mark_rows(event.rows);
+            renderer_.mark_settled_stale(event.rows);
+            break;
+        case GameEvent::Type::PieceMoved:
+        case GameEvent::Type::PieceSpawned:
+        case GameEvent::Type::StatsChanged:
+        case GameEvent::Type::PhaseChanged:
+            // The active and ghost piece are compared with what was painted at flush time.
+            break;
+    }
+}
+
+void TetrisBoard::flush_invalidations() {
+    if (!board_widget_) {
+        return;
+    }
+    if (dirty_all_) {
+        dirty_all_ = false;
+        dirty_.fill(0);
+        renderer_.mark_settled_stale(all_rows);
+        gtk_widget_queue_draw(board_widget_);
+        return;
+    }
+    mark_cells(painted_active_);
+    mark_cells(painted_ghost_);
+    mark_cells(game_.active_cells());
+    if (game_.is_running()) {
+        mark_cells(game_.ghost_cells());
+    }
+
+    // Grown by a pixel on each side for the strokes on cell edges.
+    int origin_x = 0;
+    int origin_y = 0;
+    grid_origin(board_widget_, TetrisGame::WIDTH, TetrisGame::HEIGHT, origin_x, origin_y);
+    for (int row = 0; row < TetrisGame::HEIGHT;) {
+        if (dirty_[row] == 0) {
+            ++row;
+            continue;
+        }
+        int first = row;
+        unsigned int columns = 0;
+        while (row < TetrisGame::HEIGHT && dirty_[row] != 0) {
+            columns |= dirty_[row++];
+        }
+        int left = __builtin_ctz(columns);
+        int right = 31 - __builtin_clz(columns);
+        gtk_widget_queue_draw_area(board_widget_,
+                                   origin_x + left * block_size_ - 1,
+                                   origin_y + first * block_size_ - 1,
+                                   (right - left + 1) * block_size_ + 2,
+                                   (row - first) * block_size_ + 2);
+    }
+    dirty_.fill(0);
+}
+
+void TetrisBoard::mark_cells(const TetrisGame::Cells& cells) {
+    for (const auto& cell : cells) {
+        if (cell.x >= 0 && cell.x < TetrisGame::WIDTH && cell.y >= 0 && cell.y < TetrisGame::HEIGHT) {
+            dirty_[cell.y] |= static_cast<std::uint16_t>(1u << cell.x);
+        }
+    }
+}
+
+void TetrisBoard::mark_rows(std::uint32_t rows) {
+    for (; rows != 0; rows &= rows - 1) {
+        dirty_[__builtin_ctz(rows)] = all_columns;
+    }
+}
+
+void TetrisBoard::grid_origin(GtkWidget* widget, int cols, int rows, int& x, int& y) const {
+    GtkAllocation allocation;
+    gtk_widget_get_allocation(widget, &allocation);
+    x = std::max(0, (allocation.width - block_size_ * cols) / 2);
+    y = std::max(0, (allocation.height - block_size_ * rows) / 2);
+}
+
 void TetrisBoard::setup_widgets() {
     board_widget_ = gtk_drawing_area_new();
     next_widget_ = gtk_drawing_area_new();
@@ -84,18 +212,19 @@ void TetrisBoard::setup_widgets() {
                      this);
 }
 
-gboolean TetrisBoard::on_board_draw(GtkWidget* widget, GdkEventExpose*) {
-    CairoContext ctx(widget);
+gboolean TetrisBoard::on_board_draw(GtkWidget* widget, GdkEventExpose* event) {
+    ExposeContext ctx(widget, event);
     if (auto* cr = ctx.get()) {
-        render_board(cr);
+        render_board(cr, ctx.area());
+        input_latency::painted();
     }
     return FALSE;
 }
 
-gboolean TetrisBoard::on_next_draw(GtkWidget* widget, GdkEventExpose*) {
-    CairoContext ctx(widget);
+gboolean TetrisBoard::on_next_draw(GtkWidget* widget, GdkEventExpose* event) {
+    ExposeContext ctx(widget, event);
     if (auto* cr = ctx.get()) {
-        render_next(cr);
+        render_next(cr, ctx.area());
     }
     return FALSE;
 }
@@ -113,116 +242,43 @@ void TetrisBoard::on_board_size_allocate(GtkAllocation* allocation) {
     update_block_size_from_allocation(*allocation);
 }
 
-void TetrisBoard::render_board(cairo_t* cr) {
-    auto active = game_.active_cells();
-    render_grid(board_widget_,
-                cr,
-                TetrisGame::WIDTH,
-                TetrisGame::HEIGHT,
-                active,
-                true,
-                show_grid_);
-}
-
-void TetrisBoard::render_next(cairo_t* cr) {
-    auto next = game_.next_cells();
-    render_grid(next_widget_, cr, 4, 4, next, false, false);
-}
-
-void TetrisBoard::render_grid(GtkWidget* widget,
-                              cairo_t* cr,
-                              int cols,
-                              int rows,
-                              const std::vector<TetrisGame::Cell>& overlays,
-                              bool draw_settled,
-                              bool draw_grid) {
-    if (!widget || !cr) {
-        return;
+void TetrisBoard::render_board(cairo_t* cr, const GdkRectangle& area) {
+    painted_active_ = game_.active_cells();
+    painted_ghost_.clear();
+    if (game_.is_running()) {
+        painted_ghost_ = game_.ghost_cells();
     }
     GtkAllocation allocation;
-    gtk_widget_get_allocation(widget, &allocation);
-    fill_background(cr, allocation.width, allocation.height);
-
-    int render_width = block_size_ * cols;
-    int render_height = block_size_ * rows;
-    int offset_x = std::max(0, (allocation.width - render_width) / 2);
-    int offset_y = std::max(0, (allocation.height - render_height) / 2);
-
+    gtk_widget_get_allocation(board_widget_, &allocation);
+    BoardRenderer::fill_background(cr, allocation.width, allocation.height);
+    int origin_x = 0;
+    int origin_y = 0;
+    grid_origin(board_widget_, TetrisGame::WIDTH, TetrisGame::HEIGHT, origin_x, origin_y);
     cairo_save(cr);
-    cairo_translate(cr, offset_x, offset_y);
-
-    const bool is_clearing = game_.is_clearing();
-    const bool flash_on = game_.flash_visible();
-    const auto& flashing_rows = game_.clearing_rows();
-    auto row_is_flashing = [&](int row) {
-        return std::find(flashing_rows.begin(), flashing_rows.end(), row) != flashing_rows.end();
-    };
-
-    if (draw_settled) {
-        const auto& settled = game_.board();
-        for (int y = 0; y < rows; ++y) {
-            for (int x = 0; x < cols; ++x) {
-                int color = settled[y][x];
-                if (color != 0) {
-                    if (!(is_clearing && !flash_on && row_is_flashing(y))) {
-                        draw_cell(cr, x, y, color);
-                    }
-                } else if (draw_grid) {
-                    cairo_set_source_rgb(cr, 0.9, 0.9, 0.9);
-                    cairo_rectangle(cr, x * block_size_, y * block_size_, block_size_, block_size_);
-                    cairo_stroke(cr);
-                }
-            }
-        }
-    } else if (draw_grid) {
-        for (int y = 0; y < rows; ++y) {
-            for (int x = 0; x < cols; ++x) {
-                cairo_set_source_rgb(cr, 0.9, 0.9, 0.9);
-                cairo_rectangle(cr, x * block_size_, y * block_size_, block_size_, block_size_);
-                cairo_stroke(cr);
-            }
-        }
-    }
-
-    for (const auto& cell : overlays) {
-        if (!(is_clearing && !flash_on && row_is_flashing(cell.y))) {
-            draw_cell(cr, cell.x, cell.y, cell.color);
-        }
-    }
-
+    cairo_translate(cr, origin_x, origin_y);
+    renderer_.render_board(cr,
+                           {area.x - origin_x, area.y - origin_y, area.width, area.height},
+                           painted_active_,
+                           painted_ghost_);
     cairo_restore(cr);
 }
 
-void TetrisBoard::draw_cell(cairo_t* cr, int x, int y, int color) {
-    if (color < 0 || color > 8) {
-        return;
-    }
-    const auto& rgb = normalized_colors_[color];
-    const auto [r, g, b] = rgb;
-
-    double offset = 1.0;
-    cairo_set_source_rgb(cr, r, g, b);
-    cairo_rectangle(cr,
-                    x * block_size_ + offset,
-                    y * block_size_ + offset,
-                    block_size_ - 2 * offset,
-                    block_size_ - 2 * offset);
-    cairo_fill(cr);
-
-    // simple border
-    cairo_set_source_rgb(cr, 1, 1, 1);
-    cairo_rectangle(cr,
-                    x * block_size_ + offset,
-                    y * block_size_ + offset,
-                    block_size_ - 2 * offset,
-                    block_size_ - 2 * offset);
-    cairo_stroke(cr);
-}
-
-void TetrisBoard::fill_background(cairo_t* cr, int width, int height) {
-    cairo_set_source_rgb(cr, 1, 1, 1);
-    cairo_rectangle(cr, 0, 0, width, height);
-    cairo_fill(cr);
+void TetrisBoard::render_next(cairo_t* cr, const GdkRectangle& area) {
+    constexpr int preview_cells = 4;
+    GtkAllocation allocation;
+    gtk_widget_get_allocation(next_widget_, &allocation);
+    BoardRenderer::fill_background(cr, allocation.width, allocation.height);
+    int origin_x = 0;
+    int origin_y = 0;
+    grid_origin(next_widget_, preview_cells, preview_cells, origin_x, origin_y);
+    cairo_save(cr);
+    cairo_translate(cr, origin_x, origin_y);
+    renderer_.render_preview(cr,
+                             {area.x - origin_x, area.y - origin_y, area.width, area.height},
+                             game_.next_cells(),
+                             preview_cells,
+                             preview_cells);
+    cairo_restore(cr);
 }
 
 void TetrisBoard::update_block_size_from_allocation(const GtkAllocation& allocation) {
@@ -236,19 +292,10 @@ void TetrisBoard::update_block_size_from_allocation(const GtkAllocation& allocat
     }
 
     block_size_ = candidate;
+    renderer_.set_block_size(block_size_);
     if (next_widget_) {
         gtk_widget_set_size_request(next_widget_, block_size_ * 4, block_size_ * 4);
     }
     queue_draw();
     queue_next_draw();
 }
-
-void TetrisBoard::initialize_color_cache() {
-    std::transform(block_colors_.begin(),
-                   block_colors_.end(),
-                   normalized_colors_.begin(),
-                   [](const auto& rgb) {
-                       return Color{rgb[0] / 255.0, rgb[1] / 255.0, rgb[2] / 255.0};
-                   });
-}
-
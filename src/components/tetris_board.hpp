@@ -1,9 +1,10 @@
 #pragma once
 
 #include <array>
-#include <vector>
+#include <cstdint>
 #include <gtk/gtk.h>
 
+#include "board_renderer.hpp"
 #include "tetris_game.hpp"
 
 class TetrisBoard {
@@ -16,43 +17,32 @@ public:
     void queue_draw();
     void queue_next_draw();
 
-private:
-    using Color = std::array<double, 3>;
-    inline static constexpr std::array<std::array<int, 3>, 9> block_colors_{{
-        {0, 0, 0},
-        {97, 97, 213},
-        {97, 209, 98},
-        {212, 97, 98},
-        {217, 217, 218},
-        {212, 97, 213},
-        {97, 204, 203},
-        {212, 212, 98},
-        {150, 150, 150},
-    }};
+    // Collects the cells engine events changed; flush_invalidations() adds
+    // the active and ghost piece as last painted and as they are now, then
+    // invalidates one rectangle per band of dirty rows.
+    void invalidate(const GameEvent& event);
+    void invalidate_all() { dirty_all_ = true; }
+    void flush_invalidations();
 
+private:
     TetrisGame& game_;
     GtkWidget* board_widget_;
     GtkWidget* next_widget_;
     int block_size_;
-    bool show_grid_;
-    std::array<Color, 9> normalized_colors_{};
-
-    void render_board(cairo_t* cr);
-    void render_next(cairo_t* cr);
-    void render_grid(GtkWidget* widget,
-                     cairo_t* cr,
-                     int cols,
-                     int rows,
-                     const std::vector<TetrisGame::Cell>& overlays,
-                     bool draw_settled,
-                     bool draw_grid);
-    void draw_cell(cairo_t* cr, int x, int y, int color);
-    void fill_background(cairo_t* cr, int width, int height);
+    BoardRenderer renderer_;
+    std::array<std::uint16_t, TetrisGame::HEIGHT> dirty_{};  // bit x of dirty_[y] set when (x, y) needs a repaint
+    bool dirty_all_ = false;
+    TetrisGame::Cells painted_active_;
+    TetrisGame::Cells painted_ghost_;
+
+    void mark_cells(const TetrisGame::Cells& cells);
+    void mark_rows(std::uint32_t rows);
+    void grid_origin(GtkWidget* widget, int cols, int rows, int& x, int& y) const;
+    void render_board(cairo_t* cr, const GdkRectangle& area);
+    void render_next(cairo_t* cr, const GdkRectangle& area);
     void setup_widgets();
     void update_block_size_from_allocation(const GtkAllocation& allocation);
-    void initialize_color_cache();
     gboolean on_board_draw(GtkWidget* widget, GdkEventExpose* event);
     gboolean on_next_draw(GtkWidget* widget, GdkEventExpose* event);
     void on_board_size_allocate(GtkAllocation* allocation);
 };
-
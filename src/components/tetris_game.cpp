@@ -1,89 +1,98 @@
 #include "tetris_game.hpp"
 
+#include "replay.hpp"
+#include "snapshot.hpp"
+#include "zobrist.hpp"
+
 #include <algorithm>
 #include <array>
 #include <chrono>
+#include <random>
+#include <type_traits>
 
 namespace {
 constexpr std::array<int, 4> lines_score{40, 100, 300, 1200};
+constexpr std::uint32_t all_rows = (1u << TetrisGame::HEIGHT) - 1;
+
+std::uint32_t row_mask(const TetrisGame::Rows& rows) {
+    std::uint32_t mask = 0;
+    for (int row : rows) {
+        mask |= 1u << row;
+    }
+    return mask;
+}
+
+// Both sides stop at the end of the blob instead of running past it; a
+// field list that no longer adds up to SNAPSHOT_SIZE shows as a cursor
+// that did not finish exactly at the end.
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(TetrisGame::Snapshot& out) : cursor_(out.data()), end_(out.data() + out.size()) {}
+
+    template <typename T>
+    void put(T value) {
+        auto bits = static_cast<std::make_unsigned_t<T>>(value);
+        for (std::size_t i = 0; i < sizeof(T); ++i) {
+            if (cursor_ == end_) {
+                overflowed_ = true;
+                return;
+            }
+            *cursor_++ = static_cast<std::uint8_t>(bits >> (8 * i));
+        }
+    }
+
+    [[nodiscard]] bool complete() const { return cursor_ == end_ && !overflowed_; }
+
+private:
+    std::uint8_t* cursor_;
+    std::uint8_t* end_;
+    bool overflowed_ = false;
+};
+
+class SnapshotReader {
+public:
+    explicit SnapshotReader(const TetrisGame::Snapshot& in) : cursor_(in.data()), end_(in.data() + in.size()) {}
+
+    template <typename T>
+    T get() {
+        using Bits = std::make_unsigned_t<T>;
+        Bits bits = 0;
+        for (std::size_t i = 0; i < sizeof(T); ++i) {
+            if (cursor_ == end_) {
+                overflowed_ = true;
+                return 0;
+            }
+            bits = static_cast<Bits>(bits | static_cast<Bits>(*cursor_++) << (8 * i));
+        }
+        return static_cast<T>(bits);
+    }
+
+    [[nodiscard]] bool complete() const { return cursor_ == end_ && !overflowed_; }
+
+private:
+    const std::uint8_t* cursor_;
+    const std::uint8_t* end_;
+    bool overflowed_ = false;
+};
+
+std::uint32_t elapsed_ms(TetrisGame::TimePoint now, TetrisGame::TimePoint since) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - since).count();
+    return static_cast<std::uint32_t>(std::clamp<long long>(elapsed, 0, 0xFFFFFFFF));
 }
 
-const std::array<TetrisGame::Piece, TetrisGame::BLOCK_TYPES> TetrisGame::pieces_ = {{
-    // O tetromino
-    TetrisGame::Piece{
-        1,
-        {{
-            std::array<TetrisGame::Coord, 4>{{{0, 0}, {1, 0}, {0, 1}, {1, 1}}},
-            std::array<TetrisGame::Coord, 4>{{{0, 0}, {1, 0}, {0, 1}, {1, 1}}},
-            std::array<TetrisGame::Coord, 4>{{{0, 0}, {1, 0}, {0, 1}, {1, 1}}},
-            std::array<TetrisGame::Coord, 4>{{{0, 0}, {1, 0}, {0, 1}, {1, 1}}}
-        }}
-    },
-    // Z tetromino
-    TetrisGame::Piece{
-        2,
-        {{
-            std::array<TetrisGame::Coord, 4>{{{0, 1}, {1, 1}, {1, 0}, {2, 0}}},
-            std::array<TetrisGame::Coord, 4>{{{0, 0}, {0, 1}, {1, 1}, {1, 2}}},
-            std::array<TetrisGame::Coord, 4>{{{0, 1}, {1, 1}, {1, 0}, {2, 0}}},
-            std::array<TetrisGame::Coord, 4>{{{0, 0}, {0, 1}, {1, 1}, {1, 2}}}
-        }}
-    },
-    // S tetromino
-    TetrisGame::Piece{
-        2,
-        {{
-            std::array<TetrisGame::Coord, 4>{{{0, 0}, {1, 0}, {1, 1}, {2, 1}}},
-            std::array<TetrisGame::Coord, 4>{{{1, 0}, {1, 1}, {0, 1}, {0, 2}}},
-            std::array<TetrisGame::Coord, 4>{{{0, 0}, {1, 0}, {1, 1}, {2, 1}}},
-            std::array<TetrisGame::Coord, 4>{{{1, 0}, {1, 1}, {0, 1}, {0, 2}}}
-        }}
-    },
-    // I tetromino
-    TetrisGame::Piece{
-        2,
-        {{
-            std::array<TetrisGame::Coord, 4>{{{1, 0}, {1, 1}, {1, 2}, {1, 3}}},
-            std::array<TetrisGame::Coord, 4>{{{0, 0}, {1, 0}, {2, 0}, {3, 0}}},
-            std::array<TetrisGame::Coord, 4>{{{1, 0}, {1, 1}, {1, 2}, {1, 3}}},
-            std::array<TetrisGame::Coord, 4>{{{0, 0}, {1, 0}, {2, 0}, {3, 0}}}
-        }}
-    },
-    // L tetromino
-    TetrisGame::Piece{
-        4,
-        {{
-            std::array<TetrisGame::Coord, 4>{{{1, 2}, {1, 1}, {1, 0}, {2, 0}}},
-            std::array<TetrisGame::Coord, 4>{{{0, 1}, {1, 1}, {2, 1}, {2, 2}}},
-            std::array<TetrisGame::Coord, 4>{{{0, 2}, {1, 2}, {1, 1}, {1, 0}}},
-            std::array<TetrisGame::Coord, 4>{{{0, 0}, {0, 1}, {1, 1}, {2, 1}}}
-        }}
-    },
-    // J tetromino
-    TetrisGame::Piece{
-        4,
-        {{
-            std::array<TetrisGame::Coord, 4>{{{0, 0}, {1, 0}, {1, 1}, {1, 2}}},
-            std::array<TetrisGame::Coord, 4>{{{0, 1}, {1, 1}, {2, 1}, {2, 0}}},
-            std::array<TetrisGame::Coord, 4>{{{1, 0}, {1, 1}, {1, 2}, {2, 2}}},
-            std::array<TetrisGame::Coord, 4>{{{0, 2}, {0, 1}, {1, 1}, {2, 1}}}
-        }}
-    },
-    // T tetromino
-    TetrisGame::Piece{
-        4,
-        {{
-            std::array<TetrisGame::Coord, 4>{{{1, 0}, {0, 1}, {1, 1}, {2, 1}}},
-            std::array<TetrisGame::Coord, 4>{{{2, 1}, {1, 0}, {1, 1}, {1, 2}}},
-            std::array<TetrisGame::Coord, 4>{{{1, 2}, {0, 1}, {1, 1}, {2, 1}}},
-            std::array<TetrisGame::Coord, 4>{{{0, 1}, {1, 0}, {1, 1}, {1, 2}}}
-        }}
-    },
-}};
+const GameClock& steady_game_clock() {
+    static const SteadyGameClock clock;
+    return clock;
+}
+}
 
 TetrisGame::TetrisGame()
-    : rng_(static_cast<unsigned int>(Clock::now().time_since_epoch().count())) {
-    reset();
+    : TetrisGame(static_cast<std::uint32_t>(Clock::now().time_since_epoch().count())) {}
+
+TetrisGame::TetrisGame(std::uint32_t seed) : TetrisGame(seed, steady_game_clock()) {}
+
+TetrisGame::TetrisGame(std::uint32_t seed, const GameClock& clock) : clock_(&clock) {
+    reset(seed);
 }
 
 void TetrisGame::start() {
@@ -92,18 +101,34 @@ void TetrisGame::start() {
     }
 
     set_phase(Phase::Running);
+    if (recorder_) {
+        recorder_->begin(seed_);
+    }
     spawn_piece();
-    emit_state();
-    emit_stats();
+}
+
+void TetrisGame::start(std::uint32_t seed) {
+    reset(seed);
+    start();
 }
 
 void TetrisGame::reset() {
+    reset(static_cast<std::uint32_t>(rng_()));
+}
+
+void TetrisGame::reset(std::uint32_t seed) {
+    seed_ = seed;
+    rng_.seed(seed);
+    rows_.fill(0);
+    hash_ = 0;
+    profile_.clear();
     for (auto& row : board_) {
         row.fill(0);
     }
     score_ = 0;
     level_ = 0;
     lines_cleared_ = 0;
+    pieces_placed_ = 0;
     set_phase(Phase::Idle);
     reset_game_over_animation();
     clearing_rows_.clear();
@@ -118,13 +143,174 @@ void TetrisGame::reset() {
     } else {
         current_ = {};
     }
-    current_x_ = WIDTH / 2 - 2;
-    current_y_ = 0;
+    current_x_ = tetromino::spawn_x;
+    current_y_ = tetromino::spawn_y;
 
     prepare_next_piece();
 
-    emit_state();
+    emit({GameEvent::Type::BoardFilled, {}, {}, all_rows});
+    emit({GameEvent::Type::PieceSpawned, {}, current_piece()});
+    emit_stats();
+}
+
+bool TetrisGame::snapshot(Snapshot& out) const {
+    out = {};
+    SnapshotWriter writer(out);
+    for (std::uint8_t byte : snapshot_format::magic) {
+        writer.put(byte);
+    }
+    writer.put(snapshot_format::version);
+    writer.put(seed_);
+    for (std::uint32_t word : rng_.state) {
+        writer.put(word);
+    }
+    writer.put(static_cast<std::uint16_t>(rng_.index));
+    writer.put(static_cast<std::int64_t>(score_));
+    writer.put(static_cast<std::int64_t>(pieces_placed_));
+    writer.put(static_cast<std::int32_t>(lines_cleared_));
+    writer.put(static_cast<std::uint8_t>(level_));
+    writer.put(static_cast<std::uint8_t>(phase_));
+    writer.put(static_cast<std::uint8_t>(current_.type));
+    writer.put(static_cast<std::uint8_t>(current_.rotation));
+    writer.put(static_cast<std::int8_t>(current_x_));
+    writer.put(static_cast<std::int8_t>(current_y_));
+    writer.put(static_cast<std::uint8_t>(next_.type));
+    writer.put(static_cast<std::uint8_t>(next_.rotation));
+    const PieceState pending = pending_spawn_.value_or(PieceState{});
+    writer.put(static_cast<std::uint8_t>(pending_spawn_.has_value()));
+    writer.put(static_cast<std::uint8_t>(pending.type));
+    writer.put(static_cast<std::uint8_t>(pending.rotation));
+    writer.put(row_mask(clearing_rows_));
+    writer.put(static_cast<std::uint8_t>(flash_on_));
+    const bool clearing = phase_ == Phase::Clearing;
+    const auto now = clock_->now();
+    writer.put(clearing ? elapsed_ms(now, clear_start_time_) : 0u);
+    writer.put(clearing ? elapsed_ms(now, last_toggle_time_) : 0u);
+    writer.put(static_cast<std::int8_t>(game_over_fill_row_));
+    writer.put(static_cast<std::uint8_t>(game_over_animation_active_));
+    for (const auto& row : board_) {
+        for (std::uint8_t color : row) {
+            writer.put(color);
+        }
+    }
+    return writer.complete();
+}
+
+bool TetrisGame::restore(const Snapshot& snapshot) {
+    SnapshotReader reader(snapshot);
+    for (std::uint8_t byte : snapshot_format::magic) {
+        if (reader.get<std::uint8_t>() != byte) {
+            return false;
+        }
+    }
+    if (reader.get<std::uint8_t>() != snapshot_format::version) {
+        return false;
+    }
+    const auto seed = reader.get<std::uint32_t>();
+    Rng rng;
+    for (auto& word : rng.state) {
+        word = reader.get<std::uint32_t>();
+    }
+    rng.index = reader.get<std::uint16_t>();
+    const auto score = reader.get<std::int64_t>();
+    const auto pieces_placed = reader.get<std::int64_t>();
+    const auto lines = reader.get<std::int32_t>();
+    const int level = reader.get<std::uint8_t>();
+    const int phase = reader.get<std::uint8_t>();
+    PieceState current;
+    current.type = reader.get<std::uint8_t>();
+    current.rotation = reader.get<std::uint8_t>();
+    const int x = reader.get<std::int8_t>();
+    const int y = reader.get<std::int8_t>();
+    PieceState next;
+    next.type = reader.get<std::uint8_t>();
+    next.rotation = reader.get<std::uint8_t>();
+    const bool has_pending = reader.get<std::uint8_t>() != 0;
+    PieceState pending;
+    pending.type = reader.get<std::uint8_t>();
+    pending.rotation = reader.get<std::uint8_t>();
+    const auto clearing = reader.get<std::uint32_t>();
+    const bool flash_on = reader.get<std::uint8_t>() != 0;
+    const std::chrono::milliseconds clear_elapsed{reader.get<std::uint32_t>()};
+    const std::chrono::milliseconds toggle_elapsed{reader.get<std::uint32_t>()};
+    const int fill_row = reader.get<std::int8_t>();
+    const bool fill_active = reader.get<std::uint8_t>() != 0;
+    Board board{};
+    RowMasks rows{};
+    for (int row = 0; row < HEIGHT; ++row) {
+        for (int col = 0; col < WIDTH; ++col) {
+            auto color = reader.get<std::uint8_t>();
+            if (color > game_over_fill_color_) {
+                return false;
+            }
+            board[row][col] = color;
+            rows[row] |= static_cast<Row>(color != 0 ? 1u << col : 0u);
+        }
+    }
+    if (!reader.complete()) {
+        return false;
+    }
+
+    auto valid_piece = [](const PieceState& piece) {
+        return piece.type < BLOCK_TYPES && piece.rotation < pieces_[piece.type].rotation_count;
+    };
+    if (rng.index > Rng::state_size || score < 0 || pieces_placed < 0 || lines < 0 ||
+        level >= static_cast<int>(level_speeds_.size()) || phase > static_cast<int>(Phase::GameOver) ||
+        !valid_piece(current) || !valid_piece(next) || (has_pending && !valid_piece(pending)) || fill_row < -1 ||
+        fill_row >= HEIGHT || (clearing & ~all_rows) != 0 || __builtin_popcount(clearing) > 4) {
+        return false;
+    }
+    const auto restored_phase = static_cast<Phase>(phase);
+    if ((restored_phase == Phase::Running || restored_phase == Phase::Paused) &&
+        !tetromino::fits(rows, current.type, current.rotation, x, y)) {
+        return false;
+    }
+    if ((restored_phase == Phase::Clearing) != (clearing != 0)) {
+        return false;
+    }
+    for (std::uint32_t mask = clearing; mask != 0; mask &= mask - 1) {
+        if (rows[__builtin_ctz(mask)] != FULL_ROW) {
+            return false;
+        }
+    }
+
+    seed_ = seed;
+    rng_ = rng;
+    board_ = board;
+    rows_ = rows;
+    hash_ = zobrist::board(rows_);
+    profile_.rebuild(rows_);
+    score_ = static_cast<long>(score);
+    level_ = level;
+    lines_cleared_ = lines;
+    pieces_placed_ = static_cast<long>(pieces_placed);
+    current_ = current;
+    current_x_ = x;
+    current_y_ = y;
+    next_ = next;
+    pending_spawn_.reset();
+    if (has_pending) {
+        pending_spawn_ = pending;
+    }
+    clearing_rows_.clear();
+    for (std::uint32_t mask = clearing; mask != 0; mask &= mask - 1) {
+        clearing_rows_.push_back(__builtin_ctz(mask));
+    }
+    flash_on_ = flash_on;
+    const auto now = clock_->now();
+    clear_start_time_ = now - clear_elapsed;
+    last_toggle_time_ = now - toggle_elapsed;
+    game_over_fill_row_ = fill_row;
+    game_over_animation_active_ = fill_active;
+    if (recorder_) {
+        recorder_->stop();
+    }
+
+    set_phase(restored_phase);
+    emit({GameEvent::Type::BoardFilled, {}, {}, all_rows});
+    emit({GameEvent::Type::PieceSpawned, {}, current_piece()});
     emit_stats();
+    return true;
 }
 
 void TetrisGame::stop() {
@@ -155,6 +341,9 @@ bool TetrisGame::tick() {
     if (phase_ != Phase::Running) {
         return false;
     }
+    if (recorder_) {
+        recorder_->record_tick();
+    }
 
     if (try_move(0, 1)) {
         return true;
@@ -167,6 +356,9 @@ bool TetrisGame::perform_action(Action action) {
     if (!can_accept_actions()) {
         return false;
     }
+    if (recorder_) {
+        recorder_->record_action(action);
+    }
 
     switch (action) {
         case Action::MoveLeft:
@@ -198,9 +390,8 @@ bool TetrisGame::step_clear_animation() {
     return false;
 }
 
-std::vector<TetrisGame::Cell> TetrisGame::active_cells() const {
-    std::vector<Cell> cells;
-    cells.reserve(4);
+TetrisGame::Cells TetrisGame::active_cells() const {
+    Cells cells;
     const auto& frame = pieces_[current_.type].rotations[current_.rotation];
     for (const auto& coord : frame) {
         cells.push_back({current_x_ + coord.x, current_y_ + coord.y, current_.type + 1});
@@ -208,9 +399,26 @@ std::vector<TetrisGame::Cell> TetrisGame::active_cells() const {
     return cells;
 }
 
-std::vector<TetrisGame::Cell> TetrisGame::next_cells() const {
-    std::vector<Cell> cells;
-    cells.reserve(4);
+TetrisGame::Cells TetrisGame::ghost_cells() const {
+    Cells cells;
+    int landing = landing_y();
+    const auto& frame = pieces_[current_.type].rotations[current_.rotation];
+    for (const auto& coord : frame) {
+        cells.push_back({current_x_ + coord.x, landing + coord.y, current_.type + 1});
+    }
+    return cells;
+}
+
+int TetrisGame::landing_y() const {
+    int landing = profile_.drop_y(current_.type, current_.rotation, current_x_, current_y_);
+    if (landing < 0) {
+        landing = tetromino::drop_y(rows_, current_.type, current_.rotation, current_x_, current_y_);
+    }
+    return landing;
+}
+
+TetrisGame::Cells TetrisGame::next_cells() const {
+    Cells cells;
     const auto& frame = pieces_[next_.type].rotations[next_.rotation];
     for (const auto& coord : frame) {
         cells.push_back({coord.x, coord.y, next_.type + 1});
@@ -226,42 +434,36 @@ bool TetrisGame::spawn_piece() {
         current_ = next_;
         prepare_next_piece();
     }
-    current_x_ = WIDTH / 2 - 2;
-    current_y_ = 0;
+    current_x_ = tetromino::spawn_x;
+    current_y_ = tetromino::spawn_y;
+    emit({GameEvent::Type::PieceSpawned, {}, current_piece()});
 
     if (!is_valid_position(current_x_, current_y_, current_.type, current_.rotation)) {
         begin_game_over_animation();
-        emit_stats();
         return false;
     }
     return true;
 }
 
 bool TetrisGame::is_valid_position(int x, int y, int piece, int rotation) const {
-    for (int i = 0; i < 4; ++i) {
-        const auto& coord = pieces_[piece].rotations[rotation][i];
-        int block_x = x + coord.x;
-        int block_y = y + coord.y;
-
-        if (block_x < 0 || block_x >= WIDTH || block_y < 0 || block_y >= HEIGHT) {
-            return false;
-        }
-        if (board_[block_y][block_x] != 0) {
-            return false;
-        }
-    }
-    return true;
+    return tetromino::fits(rows_, piece, rotation, x, y);
 }
 
 void TetrisGame::lock_piece() {
+    const auto& shape = shapes_[current_.type][current_.rotation];
+    const auto& masks = shape.shifted[current_x_ + tetromino::x_slot_offset];
+    for (int dy = shape.top; dy <= shape.bottom; ++dy) {
+        rows_[current_y_ + dy] |= masks[dy];
+    }
+    hash_ ^= zobrist::piece(current_.type, current_.rotation, current_x_, current_y_);
+    profile_.add_piece(current_.type, current_.rotation, current_x_, current_y_);
+
     const auto& frame = pieces_[current_.type].rotations[current_.rotation];
     for (const auto& coord : frame) {
-        int block_x = current_x_ + coord.x;
-        int block_y = current_y_ + coord.y;
-        if (block_y >= 0 && block_y < HEIGHT && block_x >= 0 && block_x < WIDTH) {
-            board_[block_y][block_x] = current_.type + 1;
-        }
+        board_[current_y_ + coord.y][current_x_ + coord.x] = static_cast<std::uint8_t>(current_.type + 1);
     }
+    std::uint32_t span = (2u << (current_y_ + shape.bottom)) - (1u << (current_y_ + shape.top));
+    emit({GameEvent::Type::PieceLocked, {}, current_piece(), span});
 }
 
 void TetrisGame::update_level_and_score(int cleared_lines) {
@@ -273,15 +475,9 @@ void TetrisGame::update_level_and_score(int cleared_lines) {
     emit_stats();
 }
 
-void TetrisGame::emit_state() {
-    if (state_changed_cb_) {
-        state_changed_cb_();
-    }
-}
-
-void TetrisGame::emit_stats() {
-    if (stats_changed_cb_) {
-        stats_changed_cb_();
+void TetrisGame::emit(const GameEvent& event) {
+    if (events_.push(event) && listener_) {
+        listener_(listener_context_);
     }
 }
 
@@ -301,6 +497,33 @@ int TetrisGame::random_piece() {
     return dist(rng_);
 }
 
+// MT19937 as specified for std::mt19937, so seeds give the same games as
+// before the state was kept here.
+TetrisGame::Rng::result_type TetrisGame::Rng::operator()() {
+    constexpr std::size_t shift = 397;
+    constexpr std::uint32_t matrix = 0x9908B0DFu;
+    if (index >= state_size) {
+        for (std::size_t i = 0; i < state_size; ++i) {
+            std::uint32_t bits = (state[i] & 0x80000000u) | (state[(i + 1) % state_size] & 0x7FFFFFFFu);
+            state[i] = state[(i + shift) % state_size] ^ (bits >> 1) ^ ((bits & 1u) != 0 ? matrix : 0u);
+        }
+        index = 0;
+    }
+    std::uint32_t value = state[index++];
+    value ^= value >> 11;
+    value ^= (value << 7) & 0x9D2C5680u;
+    value ^= (value << 15) & 0xEFC60000u;
+    return value ^ (value >> 18);
+}
+
+void TetrisGame::Rng::seed(std::uint32_t value) {
+    state[0] = value;
+    for (std::size_t i = 1; i < state_size; ++i) {
+        state[i] = 1812433253u * (state[i - 1] ^ (state[i - 1] >> 30)) + static_cast<std::uint32_t>(i);
+    }
+    index = state_size;
+}
+
 bool TetrisGame::try_move(int dx, int dy) {
     if (!can_accept_actions()) {
         return false;
@@ -308,9 +531,10 @@ bool TetrisGame::try_move(int dx, int dy) {
     int new_x = current_x_ + dx;
     int new_y = current_y_ + dy;
     if (is_valid_position(new_x, new_y, current_.type, current_.rotation)) {
+        PiecePose from = current_piece();
         current_x_ = new_x;
         current_y_ = new_y;
-        emit_state();
+        emit({GameEvent::Type::PieceMoved, from, current_piece()});
         return true;
     }
     return false;
@@ -320,9 +544,7 @@ bool TetrisGame::try_rotate(int delta) {
     if (!can_accept_actions()) {
         return false;
     }
-    int frames = pieces_[current_.type].rotation_count;
-    int new_rotation = (frames + (current_.rotation + delta)) % frames;
-    return apply_rotation_with_kicks(new_rotation);
+    return apply_rotation_with_kicks(tetromino::rotated(current_.type, current_.rotation, delta));
 }
 
 bool TetrisGame::soft_drop_step() {
@@ -337,9 +559,11 @@ bool TetrisGame::hard_drop_step() {
     if (!can_accept_actions()) {
         return false;
     }
-    int dropped = 0;
-    while (try_move(0, 1)) {
-        dropped++;
+    int dropped = landing_y() - current_y_;
+    if (dropped > 0) {
+        PiecePose from = current_piece();
+        current_y_ += dropped;
+        emit({GameEvent::Type::PieceMoved, from, current_piece()});
     }
     reward_hard_drop(dropped);
     return handle_locked_piece();
@@ -360,14 +584,12 @@ void TetrisGame::reward_hard_drop(int dropped_rows) {
 
 bool TetrisGame::handle_locked_piece() {
     lock_piece();
+    pieces_placed_++;
     if (auto rows = collect_full_rows(); rows.empty()) {
         update_level_and_score(0);
-        bool alive = spawn_piece();
-        emit_state();
-        return alive;
+        return spawn_piece();
     } else {
-        begin_line_clear(std::move(rows));
-        emit_state();
+        begin_line_clear(rows);
         return true;
     }
 }
@@ -380,67 +602,82 @@ void TetrisGame::add_score(long delta) {
 }
 
 bool TetrisGame::apply_rotation_with_kicks(int new_rotation) {
-    for (int dx : rotation_kick_offsets_) {
-        int candidate_x = current_x_ + dx;
-        if (is_valid_position(candidate_x, current_y_, current_.type, new_rotation)) {
-            current_x_ = candidate_x;
-            current_.rotation = new_rotation;
-            emit_state();
-            return true;
-        }
+    int kicked_x = current_x_;
+    if (!tetromino::kick(rows_, current_.type, new_rotation, current_x_, current_y_, kicked_x)) {
+        return false;
     }
-    return false;
+    PiecePose from = current_piece();
+    current_x_ = kicked_x;
+    current_.rotation = new_rotation;
+    emit({GameEvent::Type::PieceMoved, from, current_piece()});
+    return true;
 }
 
-std::vector<int> TetrisGame::collect_full_rows() const {
-    std::vector<int> rows;
+TetrisGame::Rows TetrisGame::collect_full_rows() const {
+    Rows rows;
     for (int row = 0; row < HEIGHT; ++row) {
-        const auto& line = board_[row];
-        if (std::all_of(line.begin(), line.end(), [](int cell) { return cell != 0; })) {
+        if (rows_[row] == FULL_ROW) {
             rows.push_back(row);
         }
     }
     return rows;
 }
 
-void TetrisGame::remove_rows(const std::vector<int>& rows) {
+void TetrisGame::remove_rows(const Rows& rows) {
     if (rows.empty()) {
         return;
     }
     std::array<bool, HEIGHT> remove_flags{};
+    std::uint32_t removed = 0;
     for (int row : rows) {
         if (row >= 0 && row < HEIGHT) {
             remove_flags[row] = true;
+            removed |= 1u << row;
         }
     }
 
-    int target = HEIGHT - 1;
-    for (int row = HEIGHT - 1; row >= 0; --row) {
+    // Rows below the lowest removed one keep their place and their hash.
+    int lowest = HEIGHT - 1;
+    while (lowest >= 0 && !remove_flags[lowest]) {
+        lowest--;
+    }
+    for (int row = 0; row <= lowest; ++row) {
+        hash_ ^= zobrist::row(row, rows_[row]);
+    }
+
+    int target = lowest;
+    for (int row = lowest; row >= 0; --row) {
         if (remove_flags[row]) {
             continue;
         }
         if (target != row) {
+            rows_[target] = rows_[row];
             board_[target] = board_[row];
         }
         target--;
     }
 
     while (target >= 0) {
+        rows_[target] = 0;
         board_[target].fill(0);
         target--;
     }
+    for (int row = 0; row <= lowest; ++row) {
+        hash_ ^= zobrist::row(row, rows_[row]);
+    }
+    profile_.remove_rows(removed);
 }
 
-void TetrisGame::begin_line_clear(std::vector<int> rows) {
-    clearing_rows_ = std::move(rows);
+void TetrisGame::begin_line_clear(const Rows& rows) {
+    clearing_rows_ = rows;
     flash_on_ = true;
-    clear_start_time_ = Clock::now();
+    clear_start_time_ = clock_->now();
     last_toggle_time_ = clear_start_time_;
     set_phase(Phase::Clearing);
 }
 
 bool TetrisGame::advance_clear_animation() {
-    auto now = Clock::now();
+    auto now = clock_->now();
     bool toggled = false;
     if (now - last_toggle_time_ >= clear_effect_toggle_) {
         flash_on_ = !flash_on_;
@@ -453,7 +690,7 @@ bool TetrisGame::advance_clear_animation() {
     }
 
     if (toggled) {
-        emit_state();
+        emit({GameEvent::Type::FlashToggled, {}, {}, row_mask(clearing_rows_)});
     }
     return true;
 }
@@ -461,20 +698,18 @@ bool TetrisGame::advance_clear_animation() {
 bool TetrisGame::finish_line_clear() {
     remove_rows(clearing_rows_);
     int cleared = static_cast<int>(clearing_rows_.size());
+    emit({GameEvent::Type::RowsCleared, {}, {}, row_mask(clearing_rows_)});
     clearing_rows_.clear();
     flash_on_ = true;
     set_phase(Phase::Running);
     update_level_and_score(cleared);
-    bool alive = spawn_piece();
-    emit_state();
-    return alive;
+    return spawn_piece();
 }
 
 void TetrisGame::begin_game_over_animation() {
     set_phase(Phase::GameOver);
     game_over_animation_active_ = true;
     game_over_fill_row_ = HEIGHT - 1;
-    emit_state();
 }
 
 bool TetrisGame::advance_game_over_animation() {
@@ -492,9 +727,12 @@ bool TetrisGame::advance_game_over_animation() {
             board_[game_over_fill_row_][col] = game_over_fill_color_;
         }
     }
+    hash_ ^= zobrist::row(game_over_fill_row_, rows_[game_over_fill_row_] ^ FULL_ROW);
+    rows_[game_over_fill_row_] = FULL_ROW;
+    profile_.add_row(game_over_fill_row_, FULL_ROW);
+    emit({GameEvent::Type::BoardFilled, {}, {}, 1u << game_over_fill_row_});
 
     game_over_fill_row_--;
-    emit_state();
 
     if (game_over_fill_row_ < 0) {
         game_over_animation_active_ = false;
@@ -0,0 +1,100 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(std::size_t threads)
+    : worker_count_(threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency())),
+      queues_(new Queue[worker_count_]) {
+    threads_.reserve(worker_count_);
+    for (std::size_t worker = 0; worker < worker_count_; ++worker) {
+        threads_.emplace_back([this, worker]() { worker_loop(worker); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::parallel_for(std::size_t count, std::size_t grain, const Body& body) {
+    if (count == 0) {
+        return;
+    }
+    grain = std::max<std::size_t>(1, grain);
+    std::size_t chunks = (count + grain - 1) / grain;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        body_ = &body;
+        pending_.store(chunks);
+        for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+            auto& queue = queues_[chunk % worker_count_];
+            std::lock_guard<std::mutex> queue_lock(queue.mutex);
+            queue.ranges.push_back({chunk * grain, std::min(count, (chunk + 1) * grain)});
+        }
+        generation_++;
+    }
+    wake_.notify_all();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return pending_.load() == 0; });
+    body_ = nullptr;
+}
+
+void WorkStealingPool::worker_loop(std::size_t worker) {
+    std::uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&]() { return stopping_ || generation_ != seen; });
+            if (stopping_) {
+                return;
+            }
+            seen = generation_;
+        }
+        run_ranges(worker);
+    }
+}
+
+void WorkStealingPool::run_ranges(std::size_t worker) {
+    Range range{};
+    while (pop_local(worker, range) || steal(worker, range)) {
+        for (std::size_t index = range.begin; index < range.end; ++index) {
+            (*body_)(index, worker);
+        }
+        if (pending_.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_.notify_all();
+        }
+    }
+}
+
+bool WorkStealingPool::pop_local(std::size_t worker, Range& out) {
+    auto& queue = queues_[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.ranges.empty()) {
+        return false;
+    }
+    out = queue.ranges.back();
+    queue.ranges.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(std::size_t thief, Range& out) {
+    for (std::size_t offset = 1; offset < worker_count_; ++offset) {
+        auto& queue = queues_[(thief + offset) % worker_count_];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.ranges.empty()) {
+            out = queue.ranges.front();
+            queue.ranges.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,26 @@
+#include "transposition_table.hpp"
+
+#include <algorithm>
+
+namespace {
+
+std::size_t slot_count(std::size_t megabytes) {
+    std::size_t budget = std::max<std::size_t>(megabytes, 1) * 1024 * 1024 / (2 * sizeof(std::uint64_t));
+    std::size_t count = 1;
+    while (count * 2 <= budget) {
+        count *= 2;
+    }
+    return count;
+}
+
+}  // namespace
+
+TranspositionTable::TranspositionTable(std::size_t megabytes)
+    : mask_(slot_count(megabytes) - 1), slots_(new Slot[mask_ + 1]) {}
+
+void TranspositionTable::clear() {
+    for (std::size_t slot = 0; slot <= mask_; ++slot) {
+        slots_[slot].check.store(0, std::memory_order_relaxed);
+        slots_[slot].data.store(0, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "move_generator.hpp"
+#include "tetris_game.hpp"
+#include "tetromino.hpp"
+
+class TranspositionTable;
+class WorkStealingPool;
+
+struct EvalWeights {
+    double aggregate_height = -0.510066;
+    double lines = 0.760666;
+    double holes = -0.35663;
+    double bumpiness = -0.184483;
+    double wells = -0.1;
+};
+
+// Text format, one "name value" pair per line; missing names keep their defaults.
+[[nodiscard]] bool load_weights(const std::string& path, EvalWeights& out);
+bool save_weights(const std::string& path, const EvalWeights& weights);
+
+struct SearchConfig {
+    int depth = 1;        // 1: current piece, 2: also the next piece, 3: also the expected piece after that
+    int beam_width = 12;  // nodes kept per level when depth > 1
+    bool tucks = false;   // search every reachable placement of the current piece, not just drops from the top
+};
+
+class Autoplayer {
+public:
+    static constexpr int MAX_PLAN = 40;
+    static constexpr int MAX_PLACEMENTS = 96;
+
+    struct Plan {
+        std::array<TetrisGame::Action, MAX_PLAN> actions{};
+        int size = 0;
+        int rotation = 0;
+        int x = 0;
+        int y = 0;
+        double score = 0.0;
+
+        void push(TetrisGame::Action action) { actions[size++] = action; }
+    };
+
+    // When a pool is given, lookahead expansion is spread across its
+    // workers. Do not call plan() from inside a task running on that pool.
+    explicit Autoplayer(EvalWeights weights = {}, SearchConfig search = {}, WorkStealingPool* pool = nullptr);
+
+    // Finds the best final placement of the game's current piece and the
+    // inputs that reach it. Returns false when the piece cannot be placed.
+    [[nodiscard]] bool plan(const TetrisGame& game, Plan& out);
+
+    [[nodiscard]] const EvalWeights& weights() const { return weights_; }
+    void set_weights(const EvalWeights& weights);
+    // Caches the expected value of depth-3 leaves by zobrist hash. Keys mix
+    // in the weights, so the table may be shared with other autoplayers,
+    // including ones on other threads or with other weights.
+    void set_table(TranspositionTable* table) { table_ = table; }
+    [[nodiscard]] std::uint64_t placements_evaluated() const { return placements_evaluated_; }
+    [[nodiscard]] std::uint64_t table_hits() const { return table_hits_; }
+
+    // Computes the features from scratch; the search reads them from an incrementally kept BoardProfile.
+    [[nodiscard]] static BoardFeatures measure(const tetromino::RowMasks& board);
+    [[nodiscard]] static double score(const BoardFeatures& features, int cleared_lines, const EvalWeights& weights);
+    // Writes the piece into board, removes completed rows and returns how
+    // many there were; full_rows gets a bit set for each of them.
+    static int place(tetromino::RowMasks& board, int piece, int rotation, int x, int y, std::uint32_t& full_rows);
+
+private:
+    struct Node {
+        tetromino::RowMasks board;
+        BoardProfile profile;
+        std::uint64_t hash;
+        int root;
+        int lines;
+        double value;
+    };
+
+    // Per-worker scratch space, sized once so the search never allocates.
+    struct alignas(64) Arena {
+        std::vector<Node> nodes;
+        std::array<double, MAX_PLACEMENTS> root_best{};
+        std::uint64_t evaluated = 0;
+        std::uint64_t table_hits = 0;
+    };
+
+    EvalWeights weights_;
+    SearchConfig search_;
+    WorkStealingPool* pool_;
+    TranspositionTable* table_ = nullptr;
+    std::uint64_t weights_key_ = 0;
+    std::uint64_t placements_evaluated_ = 0;
+    std::uint64_t table_hits_ = 0;
+
+    std::array<Plan, MAX_PLACEMENTS> root_plans_{};
+    MoveGenerator moves_;
+    int root_count_ = 0;
+    std::vector<Node> frontier_;
+    std::vector<Arena> arenas_;
+    TetrisGame::PiecePose next_{};
+    int level_ = 0;
+
+    int enumerate_roots(const TetrisGame& game);
+    Plan& add_root(const Node& start, int index, int piece, int rotation, int x, int y);
+    Node child(const Node& parent, int piece, int rotation, int x, int y, Arena& arena) const;
+    void run_level(int level);
+    void expand(const Node& node, Arena& arena);
+    double expected_value(const Node& node, Arena& arena) const;
+    void collect_frontier();
+};
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "tetromino.hpp"
+
+struct BoardFeatures {
+    int aggregate_height = 0;
+    int max_height = 0;
+    int holes = 0;
+    int bumpiness = 0;
+    int wells = 0;
+
+    friend bool operator==(const BoardFeatures& a, const BoardFeatures& b) {
+        return a.aggregate_height == b.aggregate_height && a.max_height == b.max_height && a.holes == b.holes &&
+               a.bumpiness == b.bumpiness && a.wells == b.wells;
+    }
+};
+
+// Column view of a stack, kept up to date as pieces lock and rows clear.
+// Each column is a bit word (bit y set when row y is occupied), from which
+// heights follow with one ctz and holes with one popcount. Heights let a
+// piece above the surface find its landing row from at most four columns,
+// and the evaluation features are updated from the columns a change
+// touched instead of being recomputed from the grid.
+class BoardProfile {
+public:
+    using Column = std::uint32_t;
+
+    [[nodiscard]] int height(int column) const { return heights_[column]; }
+    [[nodiscard]] const std::array<int, tetromino::board_width>& heights() const { return heights_; }
+    [[nodiscard]] const BoardFeatures& features() const { return features_; }
+
+    void clear() {
+        columns_.fill(0);
+        heights_.fill(0);
+        cells_ = 0;
+        features_ = {};
+    }
+
+    void rebuild(const tetromino::RowMasks& rows) {
+        columns_.fill(0);
+        for (int y = 0; y < tetromino::board_height; ++y) {
+            for (unsigned int mask = rows[y]; mask != 0; mask &= mask - 1) {
+                columns_[__builtin_ctz(mask)] |= Column{1} << y;
+            }
+        }
+        refresh();
+    }
+
+    void add_piece(int piece, int rotation, int x, int y) {
+        const auto& shape = tetromino::shapes[piece][rotation];
+        int first = x + shape.left;
+        int last = x + shape.right;
+        int before = local_terms(first, last);
+        for (int column = first; column <= last; ++column) {
+            int offset = column - first;
+            int top = y + shape.column_top[offset];
+            int bottom = y + shape.column_bottom[offset];
+            columns_[column] |= (Column{2} << bottom) - (Column{1} << top);
+            cells_ += bottom - top + 1;
+            update_height(column);
+        }
+        features_.bumpiness += local_terms(first, last) - before;
+        features_.holes = features_.aggregate_height - cells_;
+    }
+
+    void add_row(int y, unsigned int mask) {
+        for (; mask != 0; mask &= mask - 1) {
+            columns_[__builtin_ctz(mask)] |= Column{1} << y;
+        }
+        refresh();
+    }
+
+    // Drops every row whose bit is set in `rows` and moves the rows above down.
+    void remove_rows(std::uint32_t rows) {
+        for (; rows != 0; rows &= rows - 1) {
+            int row = __builtin_ctz(rows);
+            Column above = (Column{1} << row) - 1;
+            for (auto& column : columns_) {
+                column = (column & ~(above | (Column{1} << row))) | ((column & above) << 1);
+            }
+        }
+        refresh();
+    }
+
+    // Landing row of a piece hard dropped from (x, y), or -1 when part of
+    // the piece is already below a column's top, where the profile cannot
+    // see overhangs and the caller has to probe instead.
+    [[nodiscard]] int drop_y(int piece, int rotation, int x, int y) const {
+        const auto& shape = tetromino::shapes[piece][rotation];
+        int landing = tetromino::board_height;
+        for (int column = 0; column <= shape.right - shape.left; ++column) {
+            int surface = tetromino::board_height - heights_[x + shape.left + column];
+            if (y + shape.column_bottom[column] >= surface) {
+                return -1;
+            }
+            int rest = surface - 1 - shape.column_bottom[column];
+            landing = rest < landing ? rest : landing;
+        }
+        return landing;
+    }
+
+private:
+    std::array<Column, tetromino::board_width> columns_{};
+    std::array<int, tetromino::board_width> heights_{};
+    int cells_ = 0;
+    BoardFeatures features_{};
+
+    static int difference(int a, int b) { return a > b ? a - b : b - a; }
+
+    [[nodiscard]] int rim(int column) const {
+        return column < 0 || column >= tetromino::board_width ? tetromino::board_height : heights_[column];
+    }
+
+    [[nodiscard]] int well(int column) const {
+        int left = rim(column - 1);
+        int right = rim(column + 1);
+        int edge = left < right ? left : right;
+        return edge > heights_[column] ? edge - heights_[column] : 0;
+    }
+
+    // Bumpiness of the column pairs that a change to [first, last] can
+    // alter; wells are tracked separately through update_height().
+    [[nodiscard]] int local_terms(int first, int last) const {
+        int bumpiness = 0;
+        int from = first > 0 ? first - 1 : 0;
+        int to = last < tetromino::board_width - 1 ? last : tetromino::board_width - 2;
+        for (int column = from; column <= to; ++column) {
+            bumpiness += difference(heights_[column], heights_[column + 1]);
+        }
+        return bumpiness;
+    }
+
+    void update_height(int column) {
+        int height = columns_[column] != 0 ? tetromino::board_height - __builtin_ctz(columns_[column]) : 0;
+        if (height == heights_[column]) {
+            return;
+        }
+        int from = column > 0 ? column - 1 : column;
+        int to = column < tetromino::board_width - 1 ? column + 1 : column;
+        for (int neighbour = from; neighbour <= to; ++neighbour) {
+            features_.wells -= well(neighbour);
+        }
+        features_.aggregate_height += height - heights_[column];
+        heights_[column] = height;
+        for (int neighbour = from; neighbour <= to; ++neighbour) {
+            features_.wells += well(neighbour);
+        }
+        features_.max_height = height > features_.max_height ? height : features_.max_height;
+    }
+
+    void refresh() {
+        cells_ = 0;
+        features_ = {};
+        for (int column = 0; column < tetromino::board_width; ++column) {
+            heights_[column] = columns_[column] != 0 ? tetromino::board_height - __builtin_ctz(columns_[column]) : 0;
+            cells_ += __builtin_popcount(columns_[column]);
+            features_.aggregate_height += heights_[column];
+            features_.max_height = heights_[column] > features_.max_height ? heights_[column] : features_.max_height;
+        }
+        for (int column = 0; column < tetromino::board_width; ++column) {
+            features_.wells += well(column);
+            if (column + 1 < tetromino::board_width) {
+                features_.bumpiness += difference(heights_[column], heights_[column + 1]);
+            }
+        }
+        features_.holes = features_.aggregate_height - cells_;
+    }
+};
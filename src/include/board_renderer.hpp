@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cairo.h>
+#include <cstdint>
+
+#include "palette.hpp"
+#include "tetris_game.hpp"
+
+// Cairo drawing of a TetrisGame, independent of GTK so the same code paints
+// the widgets and the offscreen surfaces of tetris_render_bench. Drawing
+// happens in pixels with the top-left cell of the grid at the origin.
+class BoardRenderer {
+public:
+    struct Area {  // pixels to repaint, relative to the grid origin
+        int x;
+        int y;
+        int width;
+        int height;
+    };
+
+    BoardRenderer(const TetrisGame& game, int block_size, bool show_grid = true);
+    ~BoardRenderer();
+
+    BoardRenderer(const BoardRenderer&) = delete;
+    BoardRenderer& operator=(const BoardRenderer&) = delete;
+
+    [[nodiscard]] int block_size() const { return block_size_; }
+    void set_block_size(int block_size);  // drops the cached surfaces
+    // Rows of the settled stack that changed since the last render_board().
+    void mark_settled_stale(std::uint32_t rows) { settled_stale_ |= rows; }
+
+    void render_board(cairo_t* cr, const Area& area, const TetrisGame::Cells& active, const TetrisGame::Cells& ghost);
+    void render_preview(cairo_t* cr, const Area& area, const TetrisGame::Cells& cells, int cols, int rows);
+    static void fill_background(cairo_t* cr, int width, int height);
+    static void set_source(cairo_t* cr, const palette::Rgb& color);
+
+private:
+    const TetrisGame& game_;
+    int block_size_;
+    bool show_grid_;
+    // Settled stack and grid, drawn with a one-pixel margin for edge strokes.
+    // Rows in settled_stale_ are repainted before the next blit.
+    inline static constexpr int settled_margin_ = 1;
+    cairo_surface_t* settled_surface_ = nullptr;
+    std::uint32_t settled_stale_ = 0;
+    // Pre-rendered cells, one column per color; created on the first draw
+    // after a block size change.
+    inline static constexpr int sprite_block_row_ = 0;
+    inline static constexpr int sprite_ghost_row_ = 1;
+    cairo_surface_t* sprites_ = nullptr;
+
+    void render_grid(cairo_t* cr,
+                     const Area& area,
+                     int cols,
+                     int rows,
+                     const TetrisGame::Cells& overlays,
+                     const TetrisGame::Cells& ghosts,
+                     bool draw_settled,
+                     bool draw_grid);
+    void update_settled_surface(cairo_t* target);
+    void paint_settled(cairo_t* cr, int first_row, int last_row);
+    void drop_settled_surface();
+    void draw_cell(cairo_t* cr, int x, int y, int color);
+    void draw_ghost_cell(cairo_t* cr, int x, int y, int color);
+    void draw_sprite(cairo_t* cr, int x, int y, int color, int row);
+    void update_sprites(cairo_t* target);
+    void drop_sprites();
+};
@@ -5,5 +5,8 @@ namespace config {
 inline constexpr char title[] = "L:A_N:application_ID:tetris:T";
 inline constexpr int desktop_width = 632;
 inline constexpr int desktop_height = 840;
+inline constexpr char replay_path[] = "last_game.ttr";
+inline constexpr char snapshot_path[] = "saved_game.tts";  // game in progress, restored paused at startup
+inline constexpr char weights_path[] = "weights.txt";  // written by tetris_tune
 
 }  // namespace config
\ No newline at end of file
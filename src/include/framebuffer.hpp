@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "palette.hpp"
+
+// Memory-mapped Linux framebuffer. open_device() takes the geometry and
+// pixel format from an fbdev node such as /dev/fb0; open_file() maps a
+// plain file of the given size instead, which stands in for a panel on
+// machines without one. Only 8-bit grayscale and RGB565 are supported.
+class Framebuffer {
+public:
+    enum class Format {
+        Gray8,
+        Rgb565
+    };
+
+    struct Rect {  // screen pixels; empty when width is 0
+        int x = 0;
+        int y = 0;
+        int width = 0;
+        int height = 0;
+    };
+
+    Framebuffer() = default;
+    ~Framebuffer();
+
+    Framebuffer(const Framebuffer&) = delete;
+    Framebuffer& operator=(const Framebuffer&) = delete;
+
+    [[nodiscard]] bool open_device(const std::string& path);
+    [[nodiscard]] bool open_file(const std::string& path, int width, int height, Format format);
+    void close();
+
+    [[nodiscard]] bool is_open() const { return pixels_ != nullptr; }
+    [[nodiscard]] int width() const { return width_; }
+    [[nodiscard]] int height() const { return height_; }
+    [[nodiscard]] int stride() const { return stride_; }  // bytes per line
+    [[nodiscard]] Format format() const { return format_; }
+    [[nodiscard]] const std::uint8_t* pixels() const { return pixels_; }
+    [[nodiscard]] int fd() const { return fd_; }  // of the device or file; -1 when closed
+
+    // Native value of `color` in this framebuffer's format.
+    [[nodiscard]] std::uint16_t pixel(const palette::Rgb& color) const;
+    // Fills a rectangle with a native pixel value, clipped to the screen.
+    void fill(int x, int y, int width, int height, std::uint16_t pixel);
+
+private:
+    void* mapping_ = nullptr;
+    std::size_t mapping_size_ = 0;
+    std::uint8_t* pixels_ = nullptr;  // first visible pixel inside mapping_
+    int fd_ = -1;
+    int width_ = 0;
+    int height_ = 0;
+    int stride_ = 0;
+    Format format_ = Format::Gray8;
+    bool inverted_ = false;  // 0 is white, as on Kindle e-ink panels
+
+    [[nodiscard]] bool map(int fd, std::size_t size);
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "framebuffer.hpp"
+#include "palette.hpp"
+#include "tetris_game.hpp"
+
+// Draws the board of a TetrisGame straight into a Framebuffer, without
+// GTK or cairo. Cells look as BoardRenderer draws them, reduced to filled
+// rectangles: empty cells with a grid outline, blocks inset behind a
+// border, ghosts as two-pixel outlines. The look of every cell on screen
+// is remembered, so render() only rewrites cells that changed.
+class FramebufferRenderer {
+public:
+    using Rect = Framebuffer::Rect;
+
+    FramebufferRenderer(const TetrisGame& game, Framebuffer& framebuffer, int block_size, int origin_x, int origin_y);
+
+    [[nodiscard]] int block_size() const { return block_size_; }
+    void invalidate();  // the next render() redraws every cell
+    // Brings the screen up to date and returns the bounding box of what
+    // it rewrote, for the caller to refresh.
+    Rect render();
+
+private:
+    using Look = std::uint8_t;  // color index, plus ghost_look_ for a ghost outline; 0 is empty
+    inline static constexpr Look ghost_look_ = 0x10;
+    inline static constexpr Look unpainted_ = 0xFF;
+
+    const TetrisGame& game_;
+    Framebuffer& framebuffer_;
+    int block_size_;
+    int origin_x_;
+    int origin_y_;
+    std::uint16_t background_;
+    std::uint16_t grid_;
+    std::uint16_t border_;
+    std::array<std::uint16_t, palette::blocks.size()> blocks_{};
+    std::array<std::array<Look, TetrisGame::WIDTH>, TetrisGame::HEIGHT> painted_{};
+
+    void draw_cell(int x, int y, Look look);
+    void outline(int x, int y, int size, int thickness, std::uint16_t pixel);
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <chrono>
+
+class GameClock {
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+
+    virtual ~GameClock() = default;
+    [[nodiscard]] virtual TimePoint now() const = 0;
+};
+
+class SteadyGameClock final : public GameClock {
+public:
+    [[nodiscard]] TimePoint now() const override { return Clock::now(); }
+};
+
+// Only moves when told to; lets headless drivers skip animation delays.
+class ManualGameClock final : public GameClock {
+public:
+    [[nodiscard]] TimePoint now() const override { return now_; }
+    void advance(Clock::duration delta) { now_ += delta; }
+
+private:
+    TimePoint now_{};
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "tetromino.hpp"
+
+struct GameEvent {
+    enum class Type : std::uint8_t {
+        PieceMoved,    // the active piece went from `from` to `piece`; consecutive moves are merged
+        PieceSpawned,  // `piece` is the new active piece and the next piece changed
+        PieceLocked,   // `piece` was written into the stack
+        RowsCleared,   // `rows` were removed and everything above them moved down
+        StatsChanged,
+        PhaseChanged,
+        FlashToggled,  // the clear animation blinked `rows`
+        BoardFilled,   // `rows` were rewritten wholesale (game-over fill, reset)
+    };
+
+    Type type;
+    tetromino::PiecePose from{};
+    tetromino::PiecePose piece{};
+    std::uint32_t rows = 0;  // bit y set for every row the event touched
+};
+
+// Bounded FIFO the engine pushes into and the frontend drains once per
+// frame. Events that only say "something changed" are merged with an
+// identical event at the tail, so bursts like a hard drop cost one entry.
+// When the ring is full new events are dropped and overflow is flagged,
+// which tells the consumer to refresh everything.
+class GameEventQueue {
+public:
+    static constexpr std::size_t CAPACITY = 64;
+
+    // Returns true when the queue was empty, so the owner knows a drain has
+    // to be scheduled.
+    bool push(const GameEvent& event) {
+        bool was_empty = size_ == 0;
+        if (!was_empty && merge(events_[(head_ + size_ - 1) % CAPACITY], event)) {
+            return false;
+        }
+        if (size_ == CAPACITY) {
+            overflowed_ = true;
+            return false;
+        }
+        events_[(head_ + size_) % CAPACITY] = event;
+        size_++;
+        return was_empty;
+    }
+
+    bool pop(GameEvent& out) {
+        if (size_ == 0) {
+            return false;
+        }
+        out = events_[head_];
+        head_ = (head_ + 1) % CAPACITY;
+        size_--;
+        return true;
+    }
+
+    // Reports and clears the overflow flag.
+    [[nodiscard]] bool take_overflow() {
+        bool overflowed = overflowed_;
+        overflowed_ = false;
+        return overflowed;
+    }
+
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+    [[nodiscard]] std::size_t size() const { return size_; }
+
+private:
+    std::array<GameEvent, CAPACITY> events_{};
+    std::size_t head_ = 0;
+    std::size_t size_ = 0;
+    bool overflowed_ = false;
+
+    static bool merge(GameEvent& tail, const GameEvent& event) {
+        if (tail.type != event.type) {
+            return false;
+        }
+        switch (event.type) {
+            case GameEvent::Type::PieceMoved:
+                tail.piece = event.piece;
+                return true;
+            case GameEvent::Type::StatsChanged:
+            case GameEvent::Type::PhaseChanged:
+                return true;
+            case GameEvent::Type::FlashToggled:
+                tail.rows |= event.rows;
+                return true;
+            default:
+                return false;
+        }
+    }
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Log-linear histogram in the style of HdrHistogram: each power of two of
+// microseconds is split into 16 linear buckets, so every recorded value
+// is known to within 1/16 of itself, from 1 us up to about a minute, in a
+// fixed 3 KB with no allocation.
+class LatencyHistogram {
+public:
+    inline static constexpr int sub_buckets = 32;
+    inline static constexpr std::uint64_t max_micros = (std::uint64_t{1} << 26) - 1;
+    inline static constexpr int bucket_count = sub_buckets + (26 - 5) * (sub_buckets / 2);
+
+    void record(std::uint64_t micros) {
+        micros = micros < max_micros ? micros : max_micros;
+        counts_[index(micros)]++;
+        total_++;
+        sum_ += micros;
+        max_ = micros > max_ ? micros : max_;
+    }
+
+    void clear() {
+        counts_.fill(0);
+        total_ = 0;
+        sum_ = 0;
+        max_ = 0;
+    }
+
+    [[nodiscard]] std::uint64_t total() const { return total_; }
+    [[nodiscard]] std::uint64_t max() const { return max_; }
+    [[nodiscard]] double mean() const { return total_ == 0 ? 0.0 : static_cast<double>(sum_) / total_; }
+    [[nodiscard]] std::uint64_t count(int bucket) const { return counts_[bucket]; }
+
+    // Highest value that falls into `bucket`.
+    [[nodiscard]] static std::uint64_t upper_bound(int bucket) {
+        if (bucket < sub_buckets) {
+            return static_cast<std::uint64_t>(bucket);
+        }
+        int shift = (bucket - sub_buckets) / (sub_buckets / 2) + 1;
+        std::uint64_t sub = (bucket - sub_buckets) % (sub_buckets / 2) + sub_buckets / 2;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    // Upper bound of the bucket holding the value below which `fraction`
+    // of the samples fall; never above the largest recorded value.
+    [[nodiscard]] std::uint64_t percentile(double fraction) const {
+        if (total_ == 0) {
+            return 0;
+        }
+        auto rank = static_cast<std::uint64_t>(fraction * static_cast<double>(total_) + 0.5);
+        rank = rank < 1 ? 1 : rank;
+        std::uint64_t seen = 0;
+        for (int bucket = 0; bucket < bucket_count; ++bucket) {
+            seen += counts_[bucket];
+            if (seen >= rank) {
+                std::uint64_t bound = upper_bound(bucket);
+                return bound < max_ ? bound : max_;
+            }
+        }
+        return max_;
+    }
+
+private:
+    std::array<std::uint64_t, bucket_count> counts_{};
+    std::uint64_t total_ = 0;
+    std::uint64_t sum_ = 0;
+    std::uint64_t max_ = 0;
+
+    static int index(std::uint64_t micros) {
+        if (micros < sub_buckets) {
+            return static_cast<int>(micros);
+        }
+        int shift = 63 - __builtin_clzll(micros) - 4;
+        int sub = static_cast<int>(micros >> shift);
+        return sub_buckets + (shift - 1) * (sub_buckets / 2) + (sub - sub_buckets / 2);
+    }
+};
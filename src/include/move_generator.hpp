@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "tetris_game.hpp"
+#include "tetromino.hpp"
+
+// Breadth-first search over every piece state (rotation, x, y) reachable from
+// a starting pose with the game's own move, soft drop and kick rules. Finds
+// tucks and spins that dropping from the top misses. All storage is fixed
+// size, so generate() never allocates.
+class MoveGenerator {
+public:
+    static constexpr int Y_SLOT_OFFSET = 3;
+    static constexpr int X_SLOTS = tetromino::x_slots;
+    static constexpr int Y_SLOTS = tetromino::board_height + Y_SLOT_OFFSET;
+    static constexpr int STATES = 4 * Y_SLOTS * X_SLOTS;
+
+    struct Placement {
+        int rotation;
+        int x;
+        int y;
+    };
+
+    // Returns how many lockable placements are reachable from start. They are
+    // listed in the order the search reached them, so shorter inputs come first.
+    int generate(const tetromino::RowMasks& board, const TetrisGame::PiecePose& start);
+
+    [[nodiscard]] int count() const { return placement_count_; }
+    [[nodiscard]] Placement placement(int index) const;
+    // Writes the shortest inputs for placement index, ending in a hard drop.
+    // Returns the number of actions, or -1 when they do not fit in capacity.
+    int path(int index, TetrisGame::Action* out, int capacity) const;
+
+private:
+    static constexpr std::uint16_t no_parent = 0xFFFF;
+
+    std::array<std::uint64_t, (STATES + 63) / 64> visited_{};
+    std::array<std::uint16_t, STATES> queue_{};
+    std::array<std::uint16_t, STATES> parent_{};
+    std::array<TetrisGame::Action, STATES> via_{};
+    std::array<std::uint16_t, STATES> placements_{};
+    int placement_count_ = 0;
+
+    static constexpr int encode(int rotation, int x, int y) {
+        return (rotation * Y_SLOTS + y + Y_SLOT_OFFSET) * X_SLOTS + x + tetromino::x_slot_offset;
+    }
+    static constexpr Placement decode(int state) {
+        return {state / (X_SLOTS * Y_SLOTS),
+                state % X_SLOTS - tetromino::x_slot_offset,
+                state / X_SLOTS % Y_SLOTS - Y_SLOT_OFFSET};
+    }
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+#include "framebuffer.hpp"
+#include "latency_histogram.hpp"
+#include "refresh_scheduler.hpp"
+
+// Sends refreshes to a Kindle e-ink panel with the mxcfb driver's
+// MXCFB_SEND_UPDATE ioctl on the framebuffer device. The update struct
+// differs between device generations and is picked by the mxcfb_layout
+// build option. With wait_for_completion every refresh blocks until the
+// panel has finished it, and the time from sending to completion is
+// recorded.
+class MxcfbSink final : public DisplaySink {
+public:
+    MxcfbSink(int fd, bool wait_for_completion);
+
+    void refresh(const Framebuffer::Rect& area, RefreshMode mode) override;
+    [[nodiscard]] long failures() const { return failures_; }               // updates the driver rejected
+    [[nodiscard]] const LatencyHistogram& waits() const { return waits_; }  // microseconds
+
+private:
+    int fd_;
+    bool wait_;
+    std::uint32_t marker_ = 0;
+    long failures_ = 0;
+    LatencyHistogram waits_;
+};
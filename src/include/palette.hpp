@@ -0,0 +1,32 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Colors shared by every renderer. Cell colors index blocks: 0 is unused
+// by the engine, 1-7 are the piece types and 8 the game-over fill.
+namespace palette {
+
+struct Rgb {
+    std::uint8_t r;
+    std::uint8_t g;
+    std::uint8_t b;
+};
+
+inline constexpr std::array<Rgb, 9> blocks{{
+    {0, 0, 0},
+    {97, 97, 213},
+    {97, 209, 98},
+    {212, 97, 98},
+    {217, 217, 218},
+    {212, 97, 213},
+    {97, 204, 203},
+    {212, 212, 98},
+    {150, 150, 150},
+}};
+
+inline constexpr Rgb background{255, 255, 255};
+inline constexpr Rgb grid{230, 230, 230};
+inline constexpr Rgb border{255, 255, 255};  // drawn around every block
+
+}  // namespace palette
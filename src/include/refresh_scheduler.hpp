@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "framebuffer.hpp"
+
+enum class RefreshMode : std::uint8_t {
+    Fast,     // monochrome waveform (A2/DU): quick and flash-free, but ghosts the most
+    Partial,  // grayscale waveform without the flash
+    Full,     // flashing grayscale refresh of the whole screen, which clears ghosting
+};
+
+// Where refreshes go: the panel driver on a device, a recording in checks.
+class DisplaySink {
+public:
+    virtual ~DisplaySink() = default;
+    virtual void refresh(const Framebuffer::Rect& area, RefreshMode mode) = 0;
+};
+
+// Keeps every refresh it receives, for headless runs.
+class RecordingSink final : public DisplaySink {
+public:
+    struct Refresh {
+        Framebuffer::Rect area;
+        RefreshMode mode;
+    };
+
+    void refresh(const Framebuffer::Rect& area, RefreshMode mode) override { refreshes_.push_back({area, mode}); }
+    [[nodiscard]] const std::vector<Refresh>& refreshes() const { return refreshes_; }
+    void clear() { refreshes_.clear(); }
+
+private:
+    std::vector<Refresh> refreshes_;
+};
+
+struct RefreshPolicy {
+    int full_every = 16;          // refreshes between two full ones; 0 never escalates by count
+    int full_area_percent = 50;   // a frame covering at least this share of the screen refreshes fully
+    bool full_after_bulk = true;  // line clears, resets and the end of the game-over fill refresh fully
+    // Clear flashes are refreshed as they happen with the fast waveform;
+    // otherwise they wait for the next refresh of another change.
+    bool animate_clears = true;
+};
+
+struct RefreshStats {
+    long fast = 0;
+    long partials = 0;
+    long fulls = 0;
+    long long pixels = 0;  // refreshed area summed over all refreshes
+};
+
+// Collects the regions a frame changed and sends at most one refresh per
+// frame to the sink. Partial refreshes leave ghosting behind on e-ink, so
+// the scheduler escalates to a full refresh after a number of them, when
+// a frame changes most of the screen, or after a bulk change such as a
+// line clear.
+class RefreshScheduler {
+public:
+    enum class Damage : std::uint8_t {
+        Normal,     // piece moves, spawns and locks
+        Animation,  // the line clear flash and the game-over fill
+        Bulk,       // the stack changed wholesale
+    };
+
+    RefreshScheduler(DisplaySink& sink, const Framebuffer::Rect& screen, const RefreshPolicy& policy = {});
+
+    [[nodiscard]] const RefreshPolicy& policy() const { return policy_; }
+    void set_policy(const RefreshPolicy& policy) { policy_ = policy; }
+    [[nodiscard]] const RefreshStats& stats() const { return stats_; }
+
+    void damage(const Framebuffer::Rect& area, Damage kind = Damage::Normal);
+    void flush();  // ends the frame
+
+private:
+    DisplaySink& sink_;
+    Framebuffer::Rect screen_;
+    RefreshPolicy policy_;
+    RefreshStats stats_;
+    Framebuffer::Rect pending_{};
+    Framebuffer::Rect animation_{};
+    Framebuffer::Rect deferred_{};  // animation not refreshed yet under animate_clears == false
+    bool bulk_ = false;
+    int since_full_ = 0;
+
+    void send(const Framebuffer::Rect& area, RefreshMode mode);
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "game_clock.hpp"
+#include "tetris_game.hpp"
+
+// Replay files: "TTRP", a version byte, then varints for seed, final score,
+// final lines, flags and record count, followed by the records. Each record
+// is one varint (ticks_since_previous_record << 3 | kind) where kind is an
+// Action, or kind_ticks_only for ticks left over at the end of the session.
+namespace replay_format {
+inline constexpr std::uint8_t magic[4] = {'T', 'T', 'R', 'P'};
+inline constexpr std::uint8_t version = 1;
+inline constexpr unsigned int kind_bits = 3;
+inline constexpr unsigned int kind_ticks_only = 7;
+inline constexpr unsigned int flag_ends_clearing = 1;
+}  // namespace replay_format
+
+struct Replay {
+    std::uint32_t seed = 0;
+    long score = 0;
+    int lines = 0;
+    bool ends_clearing = false;  // saved while a line clear was still animating
+    std::uint32_t records = 0;
+    std::vector<std::uint8_t> events;
+};
+
+class ReplayRecorder {
+public:
+    ReplayRecorder() { events_.reserve(4096); }
+
+    void begin(std::uint32_t seed);
+    void stop() { active_ = false; }
+    void record_tick() { ++pending_ticks_; }
+    void record_action(TetrisGame::Action action);
+
+    [[nodiscard]] bool active() const { return active_; }
+    [[nodiscard]] std::vector<std::uint8_t> encode(const TetrisGame& game) const;
+    bool save(const std::string& path, const TetrisGame& game) const;
+
+private:
+    bool active_ = false;
+    std::uint32_t seed_ = 0;
+    std::uint64_t pending_ticks_ = 0;
+    std::uint32_t records_ = 0;
+    std::vector<std::uint8_t> events_;
+};
+
+struct ReplayResult {
+    bool matched = false;
+    long score = 0;
+    int lines = 0;
+    std::uint64_t ticks = 0;
+    std::uint64_t actions = 0;
+};
+
+class ReplayPlayer {
+public:
+    ReplayPlayer() : game_(0, clock_) {}
+
+    [[nodiscard]] ReplayResult play(const Replay& replay);
+
+private:
+    ManualGameClock clock_;
+    TetrisGame game_;
+
+    void settle();
+};
+
+[[nodiscard]] bool parse_replay(const std::uint8_t* data, std::size_t size, Replay& out);
+[[nodiscard]] bool load_replay(const std::string& path, Replay& out);
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "tetris_game.hpp"
+
+// Snapshot files hold one TetrisGame::Snapshot: "TTSN", a version byte,
+// then fixed-width little-endian fields in the order TetrisGame::snapshot()
+// writes them, ending with the color plane row by row.
+namespace snapshot_format {
+inline constexpr std::uint8_t magic[4] = {'T', 'T', 'S', 'N'};
+inline constexpr std::uint8_t version = 1;
+}  // namespace snapshot_format
+
+// Written to a temporary file and renamed over `path`, so an interrupted
+// save leaves the previous snapshot intact.
+[[nodiscard]] bool save_snapshot(const std::string& path, const TetrisGame& game);
+[[nodiscard]] bool load_snapshot(const std::string& path, TetrisGame& game);
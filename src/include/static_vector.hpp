@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+// Vector-like container with inline storage and a fixed capacity, for small
+// query results that should not touch the heap. Pushing past the capacity
+// is a programming error and is ignored.
+template <typename T, std::size_t Capacity>
+class StaticVector {
+public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    constexpr void push_back(const T& value) {
+        if (size_ < Capacity) {
+            items_[size_++] = value;
+        }
+    }
+    constexpr void clear() { size_ = 0; }
+
+    [[nodiscard]] constexpr std::size_t size() const { return size_; }
+    [[nodiscard]] constexpr bool empty() const { return size_ == 0; }
+    [[nodiscard]] static constexpr std::size_t capacity() { return Capacity; }
+
+    constexpr T& operator[](std::size_t index) { return items_[index]; }
+    constexpr const T& operator[](std::size_t index) const { return items_[index]; }
+
+    constexpr iterator begin() { return items_.data(); }
+    constexpr iterator end() { return items_.data() + size_; }
+    constexpr const_iterator begin() const { return items_.data(); }
+    constexpr const_iterator end() const { return items_.data() + size_; }
+
+private:
+    std::array<T, Capacity> items_{};
+    std::size_t size_ = 0;
+};
@@ -2,16 +2,23 @@
 
 #include <array>
 #include <chrono>
-#include <functional>
+#include <cstddef>
+#include <cstdint>
 #include <optional>
-#include <random>
-#include <vector>
+
+#include "board_profile.hpp"
+#include "game_clock.hpp"
+#include "game_events.hpp"
+#include "static_vector.hpp"
+#include "tetromino.hpp"
+
+class ReplayRecorder;
 
 class TetrisGame {
 public:
-    static constexpr int WIDTH = 10;
-    static constexpr int HEIGHT = 20;
-    static constexpr int BLOCK_TYPES = 7;
+    static constexpr int WIDTH = tetromino::board_width;
+    static constexpr int HEIGHT = tetromino::board_height;
+    static constexpr int BLOCK_TYPES = tetromino::piece_types;
 
     struct Cell {
         int x;
@@ -19,14 +26,30 @@ public:
         int color;
     };
 
-    using Board = std::array<std::array<int, WIDTH>, HEIGHT>;
-    using Clock = std::chrono::steady_clock;
-    using TimePoint = Clock::time_point;
+    using Cells = StaticVector<Cell, 4>;
+    using Rows = StaticVector<int, 4>;  // a piece spans at most four rows, so at most four clear at once
+
+    using PiecePose = tetromino::PiecePose;
+    using EventListener = void (*)(void* context);
+
+    using Row = tetromino::Row;
+    using RowMasks = tetromino::RowMasks;
+    static constexpr Row FULL_ROW = static_cast<Row>((1u << WIDTH) - 1);
+    using Board = std::array<std::array<std::uint8_t, WIDTH>, HEIGHT>;
+    using Clock = GameClock::Clock;
+    using TimePoint = GameClock::TimePoint;
+
+    static constexpr std::size_t SNAPSHOT_SIZE = 2753;
+    using Snapshot = std::array<std::uint8_t, SNAPSHOT_SIZE>;
 
     TetrisGame();
+    explicit TetrisGame(std::uint32_t seed);
+    TetrisGame(std::uint32_t seed, const GameClock& clock);
 
     void start();
+    void start(std::uint32_t seed);
     void reset();
+    void reset(std::uint32_t seed);
     void stop();
     void toggle_pause();
 
@@ -51,25 +74,50 @@ public:
     }
     [[nodiscard]] bool is_clearing() const { return phase_ == Phase::Clearing; }
     [[nodiscard]] bool flash_visible() const { return flash_on_; }
-    [[nodiscard]] const std::vector<int>& clearing_rows() const { return clearing_rows_; }
+    [[nodiscard]] const Rows& clearing_rows() const { return clearing_rows_; }
 
     [[nodiscard]] const Board& board() const { return board_; }
-    [[nodiscard]] std::vector<Cell> active_cells() const;
-    [[nodiscard]] std::vector<Cell> next_cells() const;
+    [[nodiscard]] const RowMasks& occupancy() const { return rows_; }
+    [[nodiscard]] std::uint64_t hash() const { return hash_; }  // zobrist hash of occupancy()
+    // Column heights and evaluation features of the settled stack, kept up to date on every lock and clear.
+    [[nodiscard]] const BoardProfile& profile() const { return profile_; }
+    [[nodiscard]] int landing_y() const;  // where a hard drop would put the active piece
+    [[nodiscard]] Cells active_cells() const;
+    [[nodiscard]] Cells ghost_cells() const;
+    [[nodiscard]] Cells next_cells() const;
+    [[nodiscard]] PiecePose current_piece() const { return {current_.type, current_.rotation, current_x_, current_y_}; }
+    [[nodiscard]] PiecePose next_piece() const {
+        return {next_.type, next_.rotation, tetromino::spawn_x, tetromino::spawn_y};
+    }
 
     long score() const { return score_; }
     int level() const { return level_; }
     int lines() const { return lines_cleared_; }
+    long pieces_placed() const { return pieces_placed_; }
     int speed_ms() const { return level_speeds_[level_]; }
-
-    void set_state_changed_cb(std::function<void()> cb) {
-        state_changed_cb_ = std::move(cb);
-        emit_state();
-    }
-    void set_stats_changed_cb(std::function<void()> cb) {
-        stats_changed_cb_ = std::move(cb);
-        emit_stats();
+    std::uint32_t seed() const { return seed_; }
+    static constexpr std::chrono::milliseconds clear_duration() { return clear_effect_duration_; }
+
+    // Complete game state in a fixed-size blob, random generator included.
+    // snapshot() fails if its fields do not fill the blob exactly, so a
+    // save never writes what restore() would reject. restore() rejects a
+    // malformed snapshot and leaves the game untouched; clear animations
+    // resume from the saved progress relative to the game clock. Recording
+    // does not carry over.
+    [[nodiscard]] bool snapshot(Snapshot& out) const;
+    [[nodiscard]] bool restore(const Snapshot& snapshot);
+
+    // Everything that changed since the last drain. The listener is called
+    // only when the queue goes from empty to non-empty, once per batch.
+    [[nodiscard]] GameEventQueue& events() { return events_; }
+    void set_event_listener(EventListener listener, void* context) {
+        listener_ = listener;
+        listener_context_ = context;
+        if (listener_ && !events_.empty()) {
+            listener_(listener_context_);
+        }
     }
+    void set_recorder(ReplayRecorder* recorder) { recorder_ = recorder; }
 
 private:
     struct PieceState {
@@ -77,15 +125,25 @@ private:
         int rotation = 0;
     };
 
+    // The mt19937 sequence, with the state kept where a snapshot can copy
+    // it: restoring 2.5 KB is constant time, where replaying the draws from
+    // the seed grows with the length of the game.
+    struct Rng {
+        using result_type = std::uint32_t;
+        static constexpr std::size_t state_size = 624;
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return 0xFFFFFFFFu; }
+        result_type operator()();
+        void seed(std::uint32_t value);
+
+        std::array<std::uint32_t, state_size> state{};
+        std::size_t index = state_size;  // next word to temper; state_size means twist first
+    };
+
     inline static constexpr std::array<int, 20> level_speeds_ = {
         1000, 886, 785, 695, 616, 546, 483, 428, 379, 336,
         298, 264, 234, 207, 183, 162, 144, 127, 113, 100};
 
-    struct Coord {
-        int x;
-        int y;
-    };
-
     enum class Phase {
         Idle,
         Running,
@@ -94,18 +152,16 @@ private:
         GameOver
     };
 
-    struct Piece {
-        int rotation_count;
-        std::array<std::array<Coord, 4>, 4> rotations;
-    };
-
-    static const std::array<Piece, BLOCK_TYPES> pieces_;
-    inline static constexpr std::array<int, 5> rotation_kick_offsets_{0, -1, 1, -2, 2};
+    inline static constexpr const auto& pieces_ = tetromino::pieces;
+    inline static constexpr const auto& shapes_ = tetromino::shapes;
     inline static constexpr std::chrono::milliseconds clear_effect_duration_{1500};
     inline static constexpr std::chrono::milliseconds clear_effect_toggle_{250};
     inline static constexpr int game_over_fill_color_ = BLOCK_TYPES + 1;
 
-    Board board_{};
+    RowMasks rows_{};  // bit x of rows_[y] is set when (x, y) is occupied
+    Board board_{};    // color plane, only read by the renderer
+    std::uint64_t hash_ = 0;
+    BoardProfile profile_;
     Phase phase_ = Phase::Idle;
     PieceState current_{};
     int current_x_ = 0;
@@ -118,11 +174,16 @@ private:
     long score_ = 0;
     int level_ = 0;
     int lines_cleared_ = 0;
-    std::function<void()> state_changed_cb_;
-    std::function<void()> stats_changed_cb_;
-
-    std::mt19937 rng_;
-    std::vector<int> clearing_rows_;
+    long pieces_placed_ = 0;
+    GameEventQueue events_;
+    EventListener listener_ = nullptr;
+    void* listener_context_ = nullptr;
+    ReplayRecorder* recorder_ = nullptr;
+
+    const GameClock* clock_;
+    std::uint32_t seed_ = 0;
+    Rng rng_;
+    Rows clearing_rows_;
     bool flash_on_ = true;
     TimePoint clear_start_time_{};
     TimePoint last_toggle_time_{};
@@ -130,11 +191,11 @@ private:
     bool spawn_piece();
     bool is_valid_position(int x, int y, int piece, int rotation) const;
     void lock_piece();
-    std::vector<int> collect_full_rows() const;
-    void remove_rows(const std::vector<int>& rows);
+    Rows collect_full_rows() const;
+    void remove_rows(const Rows& rows);
     void update_level_and_score(int cleared_lines);
-    void emit_state();
-    void emit_stats();
+    void emit(const GameEvent& event);
+    void emit_stats() { emit({GameEvent::Type::StatsChanged}); }
     void prepare_next_piece();
     int random_piece();
     bool try_move(int dx, int dy);
@@ -142,13 +203,18 @@ private:
     bool soft_drop_step();
     bool hard_drop_step();
     [[nodiscard]] bool can_accept_actions() const { return phase_ == Phase::Running; }
-    void set_phase(Phase next_phase) { phase_ = next_phase; }
+    void set_phase(Phase next_phase) {
+        if (phase_ != next_phase) {
+            phase_ = next_phase;
+            emit({GameEvent::Type::PhaseChanged});
+        }
+    }
     void reward_soft_drop();
     void reward_hard_drop(int dropped_rows);
     bool handle_locked_piece();
     void add_score(long delta);
     bool apply_rotation_with_kicks(int new_rotation);
-    void begin_line_clear(std::vector<int> rows);
+    void begin_line_clear(const Rows& rows);
     void begin_game_over_animation();
     bool advance_clear_animation();
     bool advance_game_over_animation();
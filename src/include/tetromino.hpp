@@ -0,0 +1,241 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace tetromino {
+
+inline constexpr int board_width = 10;
+inline constexpr int board_height = 20;
+inline constexpr int piece_types = 7;
+
+using Row = std::uint16_t;
+using RowMasks = std::array<Row, board_height>;
+
+struct Coord {
+    int x;
+    int y;
+};
+
+struct PiecePose {
+    int type;
+    int rotation;
+    int x;
+    int y;
+};
+
+struct Piece {
+    int rotation_count;
+    std::array<std::array<Coord, 4>, 4> rotations;
+};
+
+inline constexpr std::array<Piece, piece_types> pieces = {{
+    // O tetromino
+    Piece{
+        1,
+        {{
+            std::array<Coord, 4>{{{0, 0}, {1, 0}, {0, 1}, {1, 1}}},
+            std::array<Coord, 4>{{{0, 0}, {1, 0}, {0, 1}, {1, 1}}},
+            std::array<Coord, 4>{{{0, 0}, {1, 0}, {0, 1}, {1, 1}}},
+            std::array<Coord, 4>{{{0, 0}, {1, 0}, {0, 1}, {1, 1}}}
+        }}
+    },
+    // Z tetromino
+    Piece{
+        2,
+        {{
+            std::array<Coord, 4>{{{0, 1}, {1, 1}, {1, 0}, {2, 0}}},
+            std::array<Coord, 4>{{{0, 0}, {0, 1}, {1, 1}, {1, 2}}},
+            std::array<Coord, 4>{{{0, 1}, {1, 1}, {1, 0}, {2, 0}}},
+            std::array<Coord, 4>{{{0, 0}, {0, 1}, {1, 1}, {1, 2}}}
+        }}
+    },
+    // S tetromino
+    Piece{
+        2,
+        {{
+            std::array<Coord, 4>{{{0, 0}, {1, 0}, {1, 1}, {2, 1}}},
+            std::array<Coord, 4>{{{1, 0}, {1, 1}, {0, 1}, {0, 2}}},
+            std::array<Coord, 4>{{{0, 0}, {1, 0}, {1, 1}, {2, 1}}},
+            std::array<Coord, 4>{{{1, 0}, {1, 1}, {0, 1}, {0, 2}}}
+        }}
+    },
+    // I tetromino
+    Piece{
+        2,
+        {{
+            std::array<Coord, 4>{{{1, 0}, {1, 1}, {1, 2}, {1, 3}}},
+            std::array<Coord, 4>{{{0, 0}, {1, 0}, {2, 0}, {3, 0}}},
+            std::array<Coord, 4>{{{1, 0}, {1, 1}, {1, 2}, {1, 3}}},
+            std::array<Coord, 4>{{{0, 0}, {1, 0}, {2, 0}, {3, 0}}}
+        }}
+    },
+    // L tetromino
+    Piece{
+        4,
+        {{
+            std::array<Coord, 4>{{{1, 2}, {1, 1}, {1, 0}, {2, 0}}},
+            std::array<Coord, 4>{{{0, 1}, {1, 1}, {2, 1}, {2, 2}}},
+            std::array<Coord, 4>{{{0, 2}, {1, 2}, {1, 1}, {1, 0}}},
+            std::array<Coord, 4>{{{0, 0}, {0, 1}, {1, 1}, {2, 1}}}
+        }}
+    },
+    // J tetromino
+    Piece{
+        4,
+        {{
+            std::array<Coord, 4>{{{0, 0}, {1, 0}, {1, 1}, {1, 2}}},
+            std::array<Coord, 4>{{{0, 1}, {1, 1}, {2, 1}, {2, 0}}},
+            std::array<Coord, 4>{{{1, 0}, {1, 1}, {1, 2}, {2, 2}}},
+            std::array<Coord, 4>{{{0, 2}, {0, 1}, {1, 1}, {2, 1}}}
+        }}
+    },
+    // T tetromino
+    Piece{
+        4,
+        {{
+            std::array<Coord, 4>{{{1, 0}, {0, 1}, {1, 1}, {2, 1}}},
+            std::array<Coord, 4>{{{2, 1}, {1, 0}, {1, 1}, {1, 2}}},
+            std::array<Coord, 4>{{{1, 2}, {0, 1}, {1, 1}, {2, 1}}},
+            std::array<Coord, 4>{{{0, 1}, {1, 0}, {1, 1}, {1, 2}}}
+        }}
+    },
+}};
+
+// Shifted masks are tabulated for every origin x in [-x_slot_offset, board_width).
+inline constexpr int x_slot_offset = 3;
+inline constexpr int x_slots = board_width + x_slot_offset;
+
+struct Shape {
+    int left;    // bounding box inside the 4x4 frame
+    int right;
+    int top;
+    int bottom;
+    int min_x;   // legal range of the frame origin
+    int max_x;
+    std::array<Row, 4> rows;  // frame rows, bounding box aligned to bit 0
+    std::array<int, 4> column_top;     // per bounding-box column, first and last occupied frame row
+    std::array<int, 4> column_bottom;
+    std::array<std::array<Row, 4>, x_slots> shifted;  // frame rows at origin x, indexed by x + x_slot_offset
+};
+
+using ShapeTable = std::array<std::array<Shape, 4>, piece_types>;
+
+constexpr Shape make_shape(const std::array<Coord, 4>& frame) {
+    Shape shape{};
+    shape.left = 3;
+    shape.top = 3;
+    for (const auto& coord : frame) {
+        shape.left = coord.x < shape.left ? coord.x : shape.left;
+        shape.right = coord.x > shape.right ? coord.x : shape.right;
+        shape.top = coord.y < shape.top ? coord.y : shape.top;
+        shape.bottom = coord.y > shape.bottom ? coord.y : shape.bottom;
+    }
+    for (int column = 0; column < 4; ++column) {
+        shape.column_top[column] = 4;
+        shape.column_bottom[column] = -1;
+    }
+    for (const auto& coord : frame) {
+        int column = coord.x - shape.left;
+        shape.rows[coord.y] = static_cast<Row>(shape.rows[coord.y] | (1u << column));
+        shape.column_top[column] = coord.y < shape.column_top[column] ? coord.y : shape.column_top[column];
+        shape.column_bottom[column] = coord.y > shape.column_bottom[column] ? coord.y : shape.column_bottom[column];
+    }
+    shape.min_x = -shape.left;
+    shape.max_x = board_width - 1 - shape.right;
+    for (int x = shape.min_x; x <= shape.max_x; ++x) {
+        for (int dy = 0; dy < 4; ++dy) {
+            shape.shifted[x + x_slot_offset][dy] = static_cast<Row>(shape.rows[dy] << (x + shape.left));
+        }
+    }
+    return shape;
+}
+
+constexpr ShapeTable make_shapes() {
+    ShapeTable table{};
+    for (int piece = 0; piece < piece_types; ++piece) {
+        for (int rotation = 0; rotation < 4; ++rotation) {
+            table[piece][rotation] = make_shape(pieces[piece].rotations[rotation]);
+        }
+    }
+    return table;
+}
+
+inline constexpr ShapeTable shapes = make_shapes();
+
+constexpr bool shapes_match_pieces() {
+    for (int piece = 0; piece < piece_types; ++piece) {
+        for (int rotation = 0; rotation < 4; ++rotation) {
+            const auto& frame = pieces[piece].rotations[rotation];
+            const auto& shape = shapes[piece][rotation];
+            if (shape.min_x < -x_slot_offset || shape.min_x + shape.left != 0 ||
+                shape.max_x + shape.right != board_width - 1) {
+                return false;
+            }
+            for (int x = shape.min_x; x <= shape.max_x; ++x) {
+                int bits = 0;
+                for (int dy = 0; dy < 4; ++dy) {
+                    for (unsigned int mask = shape.shifted[x + x_slot_offset][dy]; mask != 0; mask &= mask - 1) {
+                        ++bits;
+                    }
+                }
+                if (bits != 4) {
+                    return false;
+                }
+                for (const auto& coord : frame) {
+                    int block_x = x + coord.x;
+                    if (block_x < 0 || block_x >= board_width ||
+                        ((shape.shifted[x + x_slot_offset][coord.y] >> block_x) & 1u) == 0) {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+static_assert(shapes_match_pieces(), "collision masks disagree with the piece definitions");
+
+constexpr bool fits(const RowMasks& board, int piece, int rotation, int x, int y) {
+    const auto& shape = shapes[piece][rotation];
+    if (x < shape.min_x || x > shape.max_x || y + shape.top < 0 || y + shape.bottom >= board_height) {
+        return false;
+    }
+    const auto& masks = shape.shifted[x + x_slot_offset];
+    for (int dy = shape.top; dy <= shape.bottom; ++dy) {
+        if ((board[y + dy] & masks[dy]) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline constexpr int spawn_x = board_width / 2 - 2;
+inline constexpr int spawn_y = 0;
+inline constexpr std::array<int, 5> rotation_kick_offsets{0, -1, 1, -2, 2};
+
+constexpr int rotated(int piece, int rotation, int delta) {
+    int frames = pieces[piece].rotation_count;
+    return (frames + (rotation + delta)) % frames;
+}
+
+// Tries the kick offsets in order; on success stores the new origin x.
+constexpr bool kick(const RowMasks& board, int piece, int new_rotation, int x, int y, int& kicked_x) {
+    for (int dx : rotation_kick_offsets) {
+        if (fits(board, piece, new_rotation, x + dx, y)) {
+            kicked_x = x + dx;
+            return true;
+        }
+    }
+    return false;
+}
+
+constexpr int drop_y(const RowMasks& board, int piece, int rotation, int x, int y) {
+    while (fits(board, piece, rotation, x, y + 1)) {
+        ++y;
+    }
+    return y;
+}
+
+}  // namespace tetromino
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of workers, each with its own queue of index ranges. Idle
+// workers steal ranges from the other queues, so uneven work (games that
+// last 50 pieces next to games that last 5000) still keeps every core busy.
+class WorkStealingPool {
+public:
+    using Body = std::function<void(std::size_t index, std::size_t worker)>;
+
+    explicit WorkStealingPool(std::size_t threads = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    [[nodiscard]] std::size_t size() const { return worker_count_; }
+
+    // Runs body for every index in [0, count) in chunks of `grain` and
+    // blocks until all of them have finished.
+    void parallel_for(std::size_t count, std::size_t grain, const Body& body);
+
+private:
+    struct Range {
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    struct alignas(64) Queue {
+        std::mutex mutex;
+        std::deque<Range> ranges;
+    };
+
+    std::size_t worker_count_;
+    std::unique_ptr<Queue[]> queues_;
+    std::vector<std::thread> threads_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const Body* body_ = nullptr;
+    std::uint64_t generation_ = 0;
+    bool stopping_ = false;
+    std::atomic<std::size_t> pending_{0};
+
+    void worker_loop(std::size_t worker);
+    void run_ranges(std::size_t worker);
+    bool pop_local(std::size_t worker, Range& out);
+    bool steal(std::size_t thief, Range& out);
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Fixed-size, always-replace cache keyed by 64-bit hashes and shared between
+// threads without locks. Each slot keeps key ^ data next to data; a slot torn
+// by two racing stores no longer matches its key and reads as a miss.
+// A data value of 0 marks an empty slot, so callers must never store 0.
+class TranspositionTable {
+public:
+    // Rounds the slot count down to a power of two that fits in the budget.
+    explicit TranspositionTable(std::size_t megabytes);
+
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+    [[nodiscard]] bool probe(std::uint64_t key, std::uint64_t& data) const {
+        const auto& slot = slots_[key & mask_];
+        std::uint64_t stored = slot.data.load(std::memory_order_relaxed);
+        std::uint64_t check = slot.check.load(std::memory_order_relaxed);
+        if (stored == 0 || (check ^ stored) != key) {
+            return false;
+        }
+        data = stored;
+        return true;
+    }
+
+    void store(std::uint64_t key, std::uint64_t data) {
+        auto& slot = slots_[key & mask_];
+        slot.check.store(key ^ data, std::memory_order_relaxed);
+        slot.data.store(data, std::memory_order_relaxed);
+    }
+
+    void clear();
+    [[nodiscard]] std::size_t slots() const { return mask_ + 1; }
+
+private:
+    struct Slot {
+        std::atomic<std::uint64_t> check{0};
+        std::atomic<std::uint64_t> data{0};
+    };
+
+    std::size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+};
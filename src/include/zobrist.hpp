@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "tetromino.hpp"
+
+// Zobrist hashing of board occupancy: the hash of a board is the XOR of one
+// fixed random key per occupied cell, so placing or removing blocks updates
+// it with a few XORs. Colors are not part of the hash.
+namespace zobrist {
+
+using Keys = std::array<std::array<std::uint64_t, tetromino::board_width>, tetromino::board_height>;
+
+constexpr std::uint64_t splitmix64(std::uint64_t& state) {
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+constexpr Keys make_keys() {
+    Keys keys{};
+    std::uint64_t state = 0x7E7815ull;
+    for (auto& row : keys) {
+        for (auto& key : row) {
+            key = splitmix64(state);
+        }
+    }
+    return keys;
+}
+
+inline constexpr Keys keys = make_keys();
+
+constexpr std::uint64_t row(int y, unsigned int mask) {
+    std::uint64_t hash = 0;
+    for (; mask != 0; mask &= mask - 1) {
+        hash ^= keys[y][__builtin_ctz(mask)];
+    }
+    return hash;
+}
+
+constexpr std::uint64_t board(const tetromino::RowMasks& rows) {
+    std::uint64_t hash = 0;
+    for (int y = 0; y < tetromino::board_height; ++y) {
+        hash ^= row(y, rows[y]);
+    }
+    return hash;
+}
+
+constexpr std::uint64_t piece(int type, int rotation, int x, int y) {
+    const auto& shape = tetromino::shapes[type][rotation];
+    const auto& masks = shape.shifted[x + tetromino::x_slot_offset];
+    std::uint64_t hash = 0;
+    for (int dy = shape.top; dy <= shape.bottom; ++dy) {
+        hash ^= row(y + dy, masks[dy]);
+    }
+    return hash;
+}
+
+}  // namespace zobrist
@@ -1,14 +1,24 @@
 #include <gtk/gtk.h>
 #include <gdk/gdkkeysyms.h>
+#include <glib-unix.h>
 #include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "autoplayer.hpp"
 #include "config.hpp"
+#include "components/input_latency.hpp"
+#include "components/startup_trace.hpp"
 #include "components/tetris_board.hpp"
+#include "replay.hpp"
+#include "snapshot.hpp"
 #include "tetris_game.hpp"
+#include "thread_pool.hpp"
 
 class MainWindow {
 public:
@@ -33,6 +43,7 @@ private:
     static TetrisGame::Action decode_action(gpointer data);
     static const char* kActionDataKey;
 
+    ReplayRecorder recorder_;
     TetrisGame game_;
     std::unique_ptr<TetrisBoard> board_;
     WidgetPtr window_;
@@ -42,6 +53,7 @@ private:
     GtkWidget* status_label_ = nullptr;
     GtkWidget* pause_button_ = nullptr;
     GtkWidget* start_button_ = nullptr;
+    GtkWidget* demo_button_ = nullptr;
     struct TimeoutHandle {
         ~TimeoutHandle() { reset(); }
         void assign(guint id) {
@@ -62,14 +74,28 @@ private:
 
     TimeoutHandle timer_;
     TimeoutHandle animation_timer_;
+    TimeoutHandle demo_timer_;
+    TimeoutHandle event_idle_;
+    TimeoutHandle startup_idle_;
+    gulong first_expose_handler_ = 0;
+    bool startup_finished_ = false;
+    // Created by finish_startup(); the search threads are not needed for the first frame.
+    std::unique_ptr<WorkStealingPool> search_pool_;
+    std::unique_ptr<Autoplayer> autoplayer_;
+    Autoplayer::Plan demo_plan_;
+    int demo_step_ = 0;
+    long demo_piece_ = -1;
+    bool demo_mode_ = false;
     int current_interval_ = 0;
     std::vector<GtkWidget*> resizable_buttons_;
     int button_height_ = 56;
     std::unordered_map<guint, TetrisGame::Action> keymap_;
     static constexpr guint clear_animation_interval_ms_ = 250;
+    static constexpr guint demo_interval_ms_ = 150;
 
     void initialize_game_callbacks();
-    void initialize_keymap();
+    void initialize_keymap();  // built once, by the first key press or finish_startup()
+    void finish_startup();
     void build_layout();
     void build_sidebar(GtkWidget* sidebar);
     void create_stats_section(GtkWidget* container);
@@ -82,13 +108,20 @@ private:
     void update_status_text();
     void restart_game();
     void toggle_pause();
+    void toggle_demo();
+    void stop_demo();
     void start_timer();
     void stop_timer();
     void start_animation_timer();
     void stop_animation_timer();
     void handle_game_over();
-    bool handle_key_press(guint keyval);
-    void handle_action(TetrisGame::Action action);
+    void save_replay();
+    void save_game();
+    void resume_saved_game();
+    bool handle_key_press(guint keyval, input_latency::TimePoint pressed_at);
+    // pressed_at is left at zero for moves that do not come from the player.
+    void handle_action(TetrisGame::Action action, input_latency::TimePoint pressed_at = {});
+    void drain_events();
     GtkWidget* window() const { return window_.get(); }
     gboolean on_key_press_event(GdkEventKey* event);
     void handle_destroy();
@@ -96,13 +129,22 @@ private:
 
     static gboolean tick_cb(gpointer data);
     static gboolean clear_tick_cb(gpointer data);
+    static gboolean demo_tick_cb(gpointer data);
+    static gboolean drain_events_cb(gpointer data);
+    static gboolean terminate_cb(gpointer data);
+    static gboolean report_latency_cb(gpointer data);
+    static gboolean finish_startup_cb(gpointer data);
 };
 
 int main(int argc, char* argv[]) {
+    startup_trace::begin();
     gtk_init(&argc, &argv);
+    startup_trace::mark("gtk_init");
 
     MainWindow window;
+    startup_trace::mark("MainWindow constructed");
     window.show();
+    startup_trace::mark("show");
 
     gtk_main();
     return 0;
@@ -160,10 +202,30 @@ MainWindow::MainWindow() {
                          return self ? self->on_key_press_event(event) : FALSE;
                      }),
                      this);
+    // KUAL closes applications with SIGTERM; route it through the normal teardown so the game is saved.
+    g_unix_signal_add(SIGTERM, terminate_cb, this);
+    // `kill -USR1` dumps the input latency histogram without quitting.
+    g_unix_signal_add(SIGUSR1, report_latency_cb, this);
 
     build_layout();
-    initialize_keymap();
+    startup_trace::mark("build_layout");
+    resume_saved_game();
+    startup_trace::mark("resume_saved_game");
     update_status_text();
+
+    // Everything else waits until the board has been painted once.
+    first_expose_handler_ = g_signal_connect_after(
+        board_->board_widget(),
+        "expose-event",
+        G_CALLBACK(+[](GtkWidget* widget, GdkEventExpose*, gpointer data) -> gboolean {
+            auto* self = static_cast<MainWindow*>(data);
+            startup_trace::mark("first board expose");
+            g_signal_handler_disconnect(widget, self->first_expose_handler_);
+            self->first_expose_handler_ = 0;
+            self->startup_idle_.assign(g_idle_add(finish_startup_cb, self));
+            return FALSE;
+        }),
+        this);
 }
 
 MainWindow::~MainWindow() {
@@ -175,18 +237,22 @@ void MainWindow::show() {
 }
 
 void MainWindow::initialize_game_callbacks() {
-    game_.set_state_changed_cb([this]() {
-        if (board_) {
-            board_->queue_draw();
-            board_->queue_next_draw();
-        }
-        update_status_text();
-    });
-    game_.set_stats_changed_cb([this]() { update_labels(); });
+    // Drained just ahead of GTK's redraw pass, so queued draws land in the same frame.
+    game_.set_event_listener(
+        +[](void* data) {
+            auto* self = static_cast<MainWindow*>(data);
+            if (self->event_idle_.id() == 0) {
+                self->event_idle_.assign(g_idle_add_full(G_PRIORITY_HIGH_IDLE, drain_events_cb, self, nullptr));
+            }
+        },
+        this);
+    game_.set_recorder(&recorder_);
 }
 
 void MainWindow::initialize_keymap() {
-    keymap_.clear();
+    if (!keymap_.empty()) {
+        return;
+    }
     keymap_.emplace(GDK_KEY_Left, TetrisGame::Action::MoveLeft);
     keymap_.emplace(GDK_KEY_a, TetrisGame::Action::MoveLeft);
     keymap_.emplace(GDK_KEY_A, TetrisGame::Action::MoveLeft);
@@ -207,6 +273,25 @@ void MainWindow::initialize_keymap() {
     keymap_.emplace(GDK_KEY_X, TetrisGame::Action::RotateCCW);
 
     keymap_.emplace(GDK_KEY_space, TetrisGame::Action::HardDrop);
+    startup_trace::mark("initialize_keymap");
+}
+
+void MainWindow::finish_startup() {
+    if (startup_finished_) {
+        return;
+    }
+    startup_finished_ = true;
+    startup_idle_.reset();
+    initialize_keymap();
+
+    search_pool_.reset(new WorkStealingPool());
+    autoplayer_.reset(new Autoplayer(EvalWeights{}, SearchConfig{2, 12}, search_pool_.get()));
+    EvalWeights weights;
+    if (load_weights(config::weights_path, weights)) {
+        autoplayer_->set_weights(weights);
+    }
+    startup_trace::mark("autoplayer");
+    startup_trace::report();
 }
 
 void MainWindow::build_layout() {
@@ -319,10 +404,22 @@ void MainWindow::create_controls_section(GtkWidget* container, GtkSizeGroup* siz
     gtk_widget_set_sensitive(pause_button_, FALSE);
     gtk_box_pack_start(GTK_BOX(container), pause_button_, FALSE, TRUE, 0);
 
+    demo_button_ = create_button("Demo",
+                                 G_CALLBACK(+[](GtkWidget*, gpointer data) {
+                                     if (auto* self = static_cast<MainWindow*>(data)) {
+                                         self->toggle_demo();
+                                     }
+                                 }),
+                                 this,
+                                 size_group);
+    gtk_box_pack_start(GTK_BOX(container), demo_button_, FALSE, TRUE, 0);
+
     GtkWidget* exit_button = create_button(
         "Exit",
-        G_CALLBACK(+[](GtkWidget*, gpointer) {
-            gtk_main_quit();
+        G_CALLBACK(+[](GtkWidget*, gpointer data) {
+            if (auto* self = static_cast<MainWindow*>(data)) {
+                gtk_widget_destroy(self->window());
+            }
         }),
         this,
         size_group);
@@ -364,7 +461,7 @@ GtkWidget* MainWindow::create_action_button(const char* label, TetrisGame::Actio
             if (!value) {
                 return;
             }
-            self->handle_action(decode_action(value));
+            self->handle_action(decode_action(value), input_latency::Clock::now());
         }),
         this,
         size_group);
@@ -457,6 +554,33 @@ void MainWindow::toggle_pause() {
     update_status_text();
 }
 
+void MainWindow::toggle_demo() {
+    if (demo_mode_) {
+        stop_demo();
+        return;
+    }
+    finish_startup();
+    demo_mode_ = true;
+    demo_piece_ = -1;
+    if (game_.is_paused()) {
+        toggle_pause();
+    } else if (!game_.is_running() && !game_.is_clearing()) {
+        restart_game();
+    }
+    demo_timer_.assign(g_timeout_add(demo_interval_ms_, demo_tick_cb, this));
+    if (demo_button_) {
+        gtk_button_set_label(GTK_BUTTON(demo_button_), "Stop Demo");
+    }
+}
+
+void MainWindow::stop_demo() {
+    demo_mode_ = false;
+    demo_timer_.reset();
+    if (demo_button_) {
+        gtk_button_set_label(GTK_BUTTON(demo_button_), "Demo");
+    }
+}
+
 void MainWindow::start_timer() {
     stop_timer();
     current_interval_ = game_.speed_ms();
@@ -484,12 +608,52 @@ void MainWindow::handle_game_over() {
     if (pause_button_) {
         gtk_widget_set_sensitive(pause_button_, FALSE);
     }
+    save_replay();
 }
 
-bool MainWindow::handle_key_press(guint keyval) {
+void MainWindow::save_replay() {
+    if (recorder_.active() && !recorder_.save(config::replay_path, game_)) {
+        std::cerr << "Failed to save replay to " << config::replay_path << std::endl;
+    }
+}
+
+// Only games that can continue are kept; anything else removes a stale save.
+void MainWindow::save_game() {
+    if (!game_.is_running() && !game_.is_paused() && !game_.is_clearing()) {
+        std::remove(config::snapshot_path);
+        return;
+    }
+    if (!save_snapshot(config::snapshot_path, game_)) {
+        std::cerr << "Failed to save game to " << config::snapshot_path << std::endl;
+    }
+}
+
+void MainWindow::resume_saved_game() {
+    if (!load_snapshot(config::snapshot_path, game_)) {
+        return;
+    }
+    if (game_.is_running()) {
+        game_.toggle_pause();
+    } else if (game_.is_clearing()) {
+        start_animation_timer();
+    }
+    if (start_button_) {
+        gtk_button_set_label(GTK_BUTTON(start_button_), "Restart");
+    }
+    if (pause_button_) {
+        gtk_widget_set_sensitive(pause_button_, TRUE);
+        gtk_button_set_label(GTK_BUTTON(pause_button_), game_.is_paused() ? "Resume" : "Pause");
+    }
+    update_labels();
+}
+
+// A key that arrives before the startup idle callback only needs the
+// keymap; the search threads and weights stay deferred.
+bool MainWindow::handle_key_press(guint keyval, input_latency::TimePoint pressed_at) {
+    initialize_keymap();
     auto it = keymap_.find(keyval);
     if (it != keymap_.end()) {
-        handle_action(it->second);
+        handle_action(it->second, pressed_at);
         return true;
     }
 
@@ -498,26 +662,86 @@ bool MainWindow::handle_key_press(guint keyval) {
         return true;
     }
 
+    if (keyval == GDK_KEY_i || keyval == GDK_KEY_I) {
+        toggle_demo();
+        return true;
+    }
+
     return false;
 }
 
-void MainWindow::handle_action(TetrisGame::Action action) {
-    if (!game_.perform_action(action)) {
-        return;
+void MainWindow::handle_action(TetrisGame::Action action, input_latency::TimePoint pressed_at) {
+    if (game_.perform_action(action) && pressed_at != input_latency::TimePoint{}) {
+        input_latency::input(pressed_at);
+    }
+}
+
+void MainWindow::drain_events() {
+    auto& events = game_.events();
+    bool everything = events.take_overflow();
+    bool board = everything;
+    bool next = everything;
+    bool stats = everything;
+    bool status = everything;
+    if (board_ && everything) {
+        board_->invalidate_all();
+    }
+    GameEvent event{};
+    while (events.pop(event)) {
+        if (board_) {
+            board_->invalidate(event);
+        }
+        switch (event.type) {
+            case GameEvent::Type::PieceSpawned:
+                next = true;
+                board = true;
+                break;
+            case GameEvent::Type::PieceMoved:
+            case GameEvent::Type::PieceLocked:
+            case GameEvent::Type::RowsCleared:
+            case GameEvent::Type::FlashToggled:
+            case GameEvent::Type::BoardFilled:
+                board = true;
+                break;
+            case GameEvent::Type::StatsChanged:
+                stats = true;
+                break;
+            case GameEvent::Type::PhaseChanged:
+                board = true;  // the ghost piece is only shown while running
+                status = true;
+                break;
+        }
+    }
+    if (board_ && board) {
+        board_->flush_invalidations();
+        input_latency::queued();
+    }
+    if (board_ && next) {
+        board_->queue_next_draw();
+    }
+    if (stats) {
+        update_labels();
+    }
+    if (status) {
+        update_status_text();
     }
-    update_status_text();
 }
 
 gboolean MainWindow::on_key_press_event(GdkEventKey* event) {
+    auto pressed_at = input_latency::Clock::now();
     if (!event) {
         return FALSE;
     }
-    return handle_key_press(event->keyval);
+    return handle_key_press(event->keyval, pressed_at);
 }
 
 void MainWindow::handle_destroy() {
     stop_timer();
     stop_animation_timer();
+    demo_timer_.reset();
+    save_replay();
+    save_game();
+    input_latency::report();
     gtk_main_quit();
 }
 
@@ -525,6 +749,7 @@ void MainWindow::handle_allocation(GtkAllocation* allocation) {
     if (!allocation) {
         return;
     }
+    startup_trace::mark("first size-allocate");
     int target = allocation->height / 12;
     update_button_heights(target);
 }
@@ -593,3 +818,60 @@ gboolean MainWindow::clear_tick_cb(gpointer data) {
 
     return TRUE;
 }
+
+gboolean MainWindow::drain_events_cb(gpointer data) {
+    auto* self = static_cast<MainWindow*>(data);
+    if (!self) {
+        return FALSE;
+    }
+    self->event_idle_.reset();
+    self->drain_events();
+    return FALSE;
+}
+
+gboolean MainWindow::terminate_cb(gpointer data) {
+    if (auto* self = static_cast<MainWindow*>(data)) {
+        gtk_widget_destroy(self->window());
+    }
+    return FALSE;
+}
+
+gboolean MainWindow::report_latency_cb(gpointer) {
+    input_latency::report();
+    return TRUE;
+}
+
+gboolean MainWindow::finish_startup_cb(gpointer data) {
+    if (auto* self = static_cast<MainWindow*>(data)) {
+        self->finish_startup();
+    }
+    return FALSE;
+}
+
+gboolean MainWindow::demo_tick_cb(gpointer data) {
+    auto* self = static_cast<MainWindow*>(data);
+    if (!self) {
+        return FALSE;
+    }
+
+    const auto& game = self->game_;
+    if (game.is_game_over()) {
+        self->stop_demo();
+        return FALSE;
+    }
+    if (!game.is_running()) {
+        return TRUE;
+    }
+
+    if (self->demo_piece_ != game.pieces_placed()) {
+        self->demo_piece_ = game.pieces_placed();
+        self->demo_step_ = 0;
+        if (!self->autoplayer_->plan(game, self->demo_plan_)) {
+            self->demo_plan_.size = 0;
+        }
+    }
+    if (self->demo_step_ < self->demo_plan_.size) {
+        self->handle_action(self->demo_plan_.actions[self->demo_step_++]);
+    }
+    return TRUE;
+}
@@ -0,0 +1,167 @@
+#include <cstdlib>
+#include <iostream>
+
+#include "refresh_scheduler.hpp"
+
+namespace {
+
+using Damage = RefreshScheduler::Damage;
+using Rect = Framebuffer::Rect;
+
+constexpr Rect screen{0, 0, 600, 800};
+int failures = 0;
+
+bool same(const Rect& a, const Rect& b) {
+    return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+}
+
+void expect(bool condition, const char* what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << "\n";
+        failures++;
+    }
+}
+
+// Checks that the sink received exactly one refresh since the last call,
+// with the given area and mode.
+void expect_refresh(RecordingSink& sink, const Rect& area, RefreshMode mode, const char* what) {
+    const auto& refreshes = sink.refreshes();
+    expect(refreshes.size() == 1 && same(refreshes[0].area, area) && refreshes[0].mode == mode, what);
+    sink.clear();
+}
+
+RefreshPolicy lenient() {
+    RefreshPolicy policy;
+    policy.full_every = 0;
+    policy.full_area_percent = 100;
+    return policy;
+}
+
+void normal_damage_is_partial() {
+    RecordingSink sink;
+    RefreshScheduler scheduler(sink, screen, lenient());
+    scheduler.damage({10, 20, 40, 40});
+    scheduler.damage({90, 20, 40, 80});
+    scheduler.flush();
+    expect_refresh(sink, {10, 20, 120, 80}, RefreshMode::Partial, "moves refresh their bounding box partially");
+    scheduler.flush();
+    expect(sink.refreshes().empty(), "a frame without damage sends nothing");
+    scheduler.damage({-20, 780, 40, 40});
+    scheduler.flush();
+    expect_refresh(sink, {0, 780, 20, 20}, RefreshMode::Partial, "damage is clipped to the screen");
+}
+
+void bulk_damage_is_full() {
+    RecordingSink sink;
+    RefreshScheduler scheduler(sink, screen, lenient());
+    scheduler.damage({0, 0, 40, 40}, Damage::Bulk);
+    scheduler.flush();
+    expect_refresh(sink, screen, RefreshMode::Full, "a bulk change refreshes the whole screen fully");
+
+    auto policy = lenient();
+    policy.full_after_bulk = false;
+    scheduler.set_policy(policy);
+    scheduler.damage({0, 0, 40, 40}, Damage::Bulk);
+    scheduler.flush();
+    expect_refresh(sink, {0, 0, 40, 40}, RefreshMode::Partial, "without full_after_bulk a bulk change is partial");
+}
+
+void large_area_is_full() {
+    auto policy = lenient();
+    policy.full_area_percent = 50;
+    RecordingSink sink;
+    RefreshScheduler scheduler(sink, screen, policy);
+    scheduler.damage({0, 0, 600, 399});
+    scheduler.flush();
+    expect_refresh(sink, {0, 0, 600, 399}, RefreshMode::Partial, "just under full_area_percent stays partial");
+    scheduler.damage({0, 0, 600, 400});
+    scheduler.flush();
+    expect_refresh(sink, screen, RefreshMode::Full, "full_area_percent of the screen escalates to full");
+}
+
+void animation_is_fast() {
+    RecordingSink sink;
+    RefreshScheduler scheduler(sink, screen, lenient());
+    scheduler.damage({100, 400, 400, 80}, Damage::Animation);
+    scheduler.flush();
+    expect_refresh(sink, {100, 400, 400, 80}, RefreshMode::Fast, "an animation-only frame uses the fast mode");
+    scheduler.damage({100, 400, 400, 80}, Damage::Animation);
+    scheduler.damage({140, 0, 40, 40});
+    scheduler.flush();
+    expect_refresh(sink, {100, 0, 400, 480}, RefreshMode::Partial, "animation with a move is partial over both");
+}
+
+void deferred_animation() {
+    auto policy = lenient();
+    policy.animate_clears = false;
+    RecordingSink sink;
+    RefreshScheduler scheduler(sink, screen, policy);
+    scheduler.damage({100, 400, 400, 40}, Damage::Animation);
+    scheduler.flush();
+    scheduler.damage({100, 440, 400, 40}, Damage::Animation);
+    scheduler.flush();
+    expect(sink.refreshes().empty(), "held back animation sends nothing");
+    scheduler.damage({140, 0, 40, 40});
+    scheduler.flush();
+    expect_refresh(sink, {100, 0, 400, 480}, RefreshMode::Partial, "the next change carries the held back animation");
+    scheduler.damage({140, 40, 40, 40});
+    scheduler.flush();
+    expect_refresh(sink, {140, 40, 40, 40}, RefreshMode::Partial, "held back animation is refreshed only once");
+
+    scheduler.damage({100, 400, 400, 40}, Damage::Animation);
+    scheduler.flush();
+    scheduler.damage({0, 0, 40, 40}, Damage::Bulk);
+    scheduler.flush();
+    expect_refresh(sink, screen, RefreshMode::Full, "a full refresh covers held back animation");
+    scheduler.damage({140, 0, 40, 40});
+    scheduler.flush();
+    expect_refresh(sink, {140, 0, 40, 40}, RefreshMode::Partial, "nothing stays held back after a full refresh");
+}
+
+void full_every() {
+    auto policy = lenient();
+    policy.full_every = 3;
+    RecordingSink sink;
+    RefreshScheduler scheduler(sink, screen, policy);
+    for (int frame = 0; frame < 8; ++frame) {
+        scheduler.damage({0, 0, 10, 10}, frame % 2 == 0 ? Damage::Normal : Damage::Animation);
+        scheduler.flush();
+    }
+    const auto& refreshes = sink.refreshes();
+    const RefreshMode modes[] = {RefreshMode::Partial,
+                                 RefreshMode::Fast,
+                                 RefreshMode::Partial,
+                                 RefreshMode::Full,
+                                 RefreshMode::Partial,
+                                 RefreshMode::Fast,
+                                 RefreshMode::Partial,
+                                 RefreshMode::Full};
+    bool matched = refreshes.size() == 8;
+    for (std::size_t i = 0; matched && i < refreshes.size(); ++i) {
+        matched = refreshes[i].mode == modes[i];
+    }
+    expect(matched, "every full_every + 1st refresh is full, counting fast ones");
+
+    const auto& stats = scheduler.stats();
+    expect(stats.partials == 4 && stats.fast == 2 && stats.fulls == 2, "counters split refreshes by mode");
+    expect(stats.pixels == 6 * 100 + 2 * 600LL * 800, "pixels sum the refreshed areas");
+}
+
+}  // namespace
+
+// Drives RefreshScheduler through a RecordingSink for each rule of the
+// policy and checks the mode and area of every refresh it sends.
+int main() {
+    normal_damage_is_partial();
+    bulk_damage_is_full();
+    large_area_is_full();
+    animation_is_fast();
+    deferred_animation();
+    full_every();
+    if (failures != 0) {
+        std::cerr << failures << " checks failed\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "refresh scheduler: all checks passed\n";
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,319 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "autoplayer.hpp"
+#include "framebuffer.hpp"
+#include "framebuffer_renderer.hpp"
+#include "game_clock.hpp"
+#include "mxcfb_sink.hpp"
+#include "refresh_scheduler.hpp"
+#include "tetris_game.hpp"
+
+namespace {
+
+struct Options {
+    std::string device;
+    std::string file;
+    int width = 600;
+    int height = 800;
+    Framebuffer::Format format = Framebuffer::Format::Gray8;
+    int block_size = 0;  // 0 fits the board to the screen
+    std::uint32_t seed = 1;
+    long pieces = 500;
+    bool verify = false;
+    bool wait = false;  // wait for every panel update to complete
+    RefreshPolicy policy;
+};
+
+void print_usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " --device /dev/fb0 [--wait] [options]\n"
+              << "       " << argv0 << " --file PATH [--width N] [--height N] [--format gray8|rgb565] [options]\n"
+              << "Options: [--block N] [--seed N] [--pieces N] [--verify]\n"
+              << "         [--full-every N] [--full-area PERCENT] [--no-bulk-full] [--no-clear-flash]\n";
+}
+
+bool parse_options(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--verify") == 0) {
+            options.verify = true;
+            continue;
+        }
+        if (std::strcmp(argv[i], "--wait") == 0) {
+            options.wait = true;
+            continue;
+        }
+        if (std::strcmp(argv[i], "--no-bulk-full") == 0) {
+            options.policy.full_after_bulk = false;
+            continue;
+        }
+        if (std::strcmp(argv[i], "--no-clear-flash") == 0) {
+            options.policy.animate_clears = false;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        if (std::strcmp(argv[i], "--device") == 0) {
+            options.device = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--file") == 0) {
+            options.file = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--width") == 0) {
+            options.width = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--height") == 0) {
+            options.height = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--format") == 0) {
+            if (std::strcmp(argv[i + 1], "gray8") == 0) {
+                options.format = Framebuffer::Format::Gray8;
+            } else if (std::strcmp(argv[i + 1], "rgb565") == 0) {
+                options.format = Framebuffer::Format::Rgb565;
+            } else {
+                return false;
+            }
+        } else if (std::strcmp(argv[i], "--block") == 0) {
+            options.block_size = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            options.seed = static_cast<std::uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--pieces") == 0) {
+            options.pieces = std::strtol(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--full-every") == 0) {
+            options.policy.full_every = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--full-area") == 0) {
+            options.policy.full_area_percent = std::atoi(argv[i + 1]);
+        } else {
+            return false;
+        }
+        ++i;
+    }
+    return options.device.empty() != options.file.empty() && (!options.wait || !options.device.empty()) &&
+           options.pieces > 0 && options.block_size >= 0;
+}
+
+// Keeps the refreshes for --verify and passes them on to the panel, if any.
+class PanelSink final : public DisplaySink {
+public:
+    explicit PanelSink(DisplaySink* panel) : panel_(panel) {}
+
+    void refresh(const Framebuffer::Rect& area, RefreshMode mode) override {
+        recording_.refresh(area, mode);
+        if (panel_) {
+            panel_->refresh(area, mode);
+        }
+    }
+    [[nodiscard]] const std::vector<RecordingSink::Refresh>& refreshes() const { return recording_.refreshes(); }
+
+private:
+    RecordingSink recording_;
+    DisplaySink* panel_;
+};
+
+// How the refresh scheduler should treat the board changes behind a frame.
+RefreshScheduler::Damage classify(GameEventQueue& events) {
+    constexpr std::uint32_t all_rows = (1u << TetrisGame::HEIGHT) - 1;
+    using Damage = RefreshScheduler::Damage;
+    bool bulk = events.take_overflow();
+    bool moved = false;
+    bool animated = false;
+    GameEvent event;
+    while (events.pop(event)) {
+        switch (event.type) {
+            case GameEvent::Type::PieceMoved:
+            case GameEvent::Type::PieceSpawned:
+            case GameEvent::Type::PieceLocked:
+                moved = true;
+                break;
+            case GameEvent::Type::RowsCleared:
+                bulk = true;
+                break;
+            case GameEvent::Type::FlashToggled:
+                animated = true;
+                break;
+            case GameEvent::Type::BoardFilled:
+                // The game-over fill ends with the top row.
+                bulk = bulk || event.rows == all_rows || (event.rows & 1u) != 0;
+                animated = true;
+                break;
+            default:
+                break;
+        }
+    }
+    if (bulk) {
+        return Damage::Bulk;
+    }
+    return animated && !moved ? Damage::Animation : Damage::Normal;
+}
+
+std::uint64_t fnv1a(const Framebuffer& framebuffer) {
+    std::uint64_t hash = 0xCBF29CE484222325ull;
+    const std::uint8_t* pixels = framebuffer.pixels();
+    std::size_t size = static_cast<std::size_t>(framebuffer.stride()) * framebuffer.height();
+    for (std::size_t i = 0; i < size; ++i) {
+        hash = (hash ^ pixels[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+// Counts refreshes outside the screen, full refreshes of less than the
+// screen and runs of more than full_every refreshes without a full one.
+long check_refreshes(const std::vector<RecordingSink::Refresh>& refreshes,
+                     const Framebuffer::Rect& screen,
+                     const RefreshPolicy& policy) {
+    long errors = 0;
+    int since_full = 0;
+    for (const auto& refresh : refreshes) {
+        const auto& area = refresh.area;
+        errors += area.width <= 0 || area.height <= 0 || area.x < screen.x || area.y < screen.y ||
+                  area.x + area.width > screen.x + screen.width || area.y + area.height > screen.y + screen.height;
+        if (refresh.mode == RefreshMode::Full) {
+            errors += area.x != screen.x || area.y != screen.y || area.width != screen.width ||
+                      area.height != screen.height;
+            since_full = 0;
+        } else {
+            errors += policy.full_every > 0 && since_full >= policy.full_every;
+            since_full++;
+        }
+    }
+    return errors;
+}
+
+double percentile(const std::vector<double>& sorted, double fraction) {
+    auto index = static_cast<std::size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+}  // namespace
+
+// Plays autoplayer games on the framebuffer, times every incremental
+// redraw and counts the refreshes the scheduler sends to the panel; with
+// --device they go to the e-ink driver, and --wait also times how long the
+// panel takes to finish each one.
+// --verify also redraws the whole board after each frame to check that the
+// pixels match the incremental result, and checks the refreshes against
+// the policy.
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    Framebuffer framebuffer;
+    bool opened = options.device.empty()
+                      ? framebuffer.open_file(options.file, options.width, options.height, options.format)
+                      : framebuffer.open_device(options.device);
+    if (!opened) {
+        std::cerr << "Cannot map " << (options.device.empty() ? options.file : options.device) << "\n";
+        return EXIT_FAILURE;
+    }
+    int block_size = options.block_size;
+    if (block_size == 0) {
+        block_size = std::min(framebuffer.width() / TetrisGame::WIDTH, framebuffer.height() / TetrisGame::HEIGHT);
+    }
+    if (block_size < 4) {
+        std::cerr << "Screen too small for the board\n";
+        return EXIT_FAILURE;
+    }
+    const int origin_x = (framebuffer.width() - TetrisGame::WIDTH * block_size) / 2;
+    const int origin_y = (framebuffer.height() - TetrisGame::HEIGHT * block_size) / 2;
+
+    ManualGameClock clock;
+    TetrisGame game(options.seed, clock);
+    FramebufferRenderer renderer(game, framebuffer, block_size, origin_x, origin_y);
+    std::unique_ptr<MxcfbSink> panel;
+    if (!options.device.empty()) {
+        panel = std::make_unique<MxcfbSink>(framebuffer.fd(), options.wait);
+    }
+    PanelSink sink(panel.get());
+    const Framebuffer::Rect screen{0, 0, framebuffer.width(), framebuffer.height()};
+    RefreshScheduler scheduler(sink, screen, options.policy);
+    framebuffer.fill(0, 0, framebuffer.width(), framebuffer.height(), framebuffer.pixel(palette::background));
+    scheduler.damage(screen, RefreshScheduler::Damage::Bulk);
+    Autoplayer autoplayer;
+    Autoplayer::Plan plan;
+    std::uint32_t seed = options.seed;
+    game.start(seed);
+
+    std::vector<double> micros;
+    double changed_pixels = 0.0;
+    long mismatches = 0;
+    auto frame = [&]() {
+        auto begin = std::chrono::steady_clock::now();
+        auto rect = renderer.render();
+        micros.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count());
+        changed_pixels += static_cast<double>(rect.width) * rect.height;
+        scheduler.damage(rect, classify(game.events()));
+        scheduler.flush();
+        if (options.verify) {
+            std::uint64_t incremental = fnv1a(framebuffer);
+            renderer.invalidate();
+            (void)renderer.render();
+            mismatches += fnv1a(framebuffer) != incremental;
+        }
+    };
+
+    long earlier_pieces = 0;  // placed in games that already ended
+    frame();
+    while (earlier_pieces + game.pieces_placed() < options.pieces) {
+        if (game.is_clearing() || game.is_game_over_animating()) {
+            clock.advance(std::chrono::milliseconds(250));
+            (void)game.step_clear_animation();
+            frame();
+        } else if (game.is_game_over() || !autoplayer.plan(game, plan)) {
+            earlier_pieces += game.pieces_placed();
+            game.start(++seed);
+            frame();
+        } else {
+            for (int i = 0; i < plan.size; ++i) {
+                (void)game.perform_action(plan.actions[i]);
+                frame();
+            }
+        }
+    }
+
+    std::sort(micros.begin(), micros.end());
+    std::printf("%dx%d %s, block %d px, %zu frames over %ld pieces\n",
+                framebuffer.width(),
+                framebuffer.height(),
+                framebuffer.format() == Framebuffer::Format::Gray8 ? "gray8" : "rgb565",
+                block_size,
+                micros.size(),
+                earlier_pieces + game.pieces_placed());
+    std::printf("render p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us\n",
+                percentile(micros, 0.5),
+                percentile(micros, 0.9),
+                percentile(micros, 0.99),
+                micros.back());
+    std::printf("mean update %.1f%% of the board\n",
+                100.0 * changed_pixels / static_cast<double>(micros.size()) /
+                    (static_cast<double>(TetrisGame::WIDTH) * TetrisGame::HEIGHT * block_size * block_size));
+    const auto& refreshes = scheduler.stats();
+    std::printf("refresh: %ld fast, %ld partial, %ld full, %.1f screens of pixels\n",
+                refreshes.fast,
+                refreshes.partials,
+                refreshes.fulls,
+                static_cast<double>(refreshes.pixels) / (static_cast<double>(framebuffer.width()) * framebuffer.height()));
+    if (panel) {
+        const auto& waits = panel->waits();
+        std::printf("panel: %ld failed updates\n", panel->failures());
+        if (waits.total() != 0) {
+            std::printf("panel update p50 %.1f ms, p90 %.1f ms, p99 %.1f ms, max %.1f ms\n",
+                        static_cast<double>(waits.percentile(0.5)) / 1000.0,
+                        static_cast<double>(waits.percentile(0.9)) / 1000.0,
+                        static_cast<double>(waits.percentile(0.99)) / 1000.0,
+                        static_cast<double>(waits.max()) / 1000.0);
+        }
+    }
+    if (options.verify) {
+        long refresh_errors = check_refreshes(sink.refreshes(), screen, options.policy);
+        std::printf("verify: %ld mismatched frames, %ld bad refreshes\n", mismatches, refresh_errors);
+        mismatches += refresh_errors;
+        return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <cairo.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "autoplayer.hpp"
+#include "board_renderer.hpp"
+#include "game_clock.hpp"
+#include "tetris_game.hpp"
+
+namespace {
+
+struct Options {
+    std::size_t states = 500;
+    std::uint32_t seed = 1;
+    std::vector<int> block_sizes{16, 32, 48, 64, 72};
+    bool has_expected = false;
+    std::uint64_t expected = 0;  // checksum over every block size, from a known-good run
+};
+
+struct BenchResult {
+    std::uint64_t checksum = 0;
+    std::size_t mismatches = 0;  // states whose updated pixels differ from a full paint
+};
+
+struct Timings {
+    std::vector<double> micros;
+    double seconds = 0.0;
+};
+
+void print_usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [--states N] [--seed N] [--sizes 16,32,64] [--expect CHECKSUM]\n";
+}
+
+bool parse_sizes(const char* text, std::vector<int>& out) {
+    out.clear();
+    while (*text != '\0') {
+        char* end = nullptr;
+        long value = std::strtol(text, &end, 10);
+        if (end == text || value < 4 || value > 512) {
+            return false;
+        }
+        out.push_back(static_cast<int>(value));
+        text = *end == ',' ? end + 1 : end;
+    }
+    return !out.empty();
+}
+
+bool parse_options(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 >= argc) {
+            return false;
+        }
+        if (std::strcmp(argv[i], "--sizes") == 0) {
+            if (!parse_sizes(argv[i + 1], options.block_sizes)) {
+                return false;
+            }
+        } else if (std::strcmp(argv[i], "--states") == 0) {
+            options.states = std::strtoul(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            options.seed = static_cast<std::uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--expect") == 0) {
+            char* end = nullptr;
+            options.expected = std::strtoull(argv[i + 1], &end, 16);
+            options.has_expected = end != argv[i + 1] && *end == '\0';
+            if (!options.has_expected) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+        ++i;
+    }
+    return options.states > 0;
+}
+
+// One snapshot per autoplayer move, covering stacks from empty to nearly
+// full and the line clear animation; a new seed starts when a game ends.
+std::vector<TetrisGame::Snapshot> record_states(const Options& options) {
+    std::vector<TetrisGame::Snapshot> states;
+    states.reserve(options.states);
+    ManualGameClock clock;
+    TetrisGame game(options.seed, clock);
+    Autoplayer autoplayer;
+    Autoplayer::Plan plan;
+    std::uint32_t seed = options.seed;
+    game.start(seed);
+    while (states.size() < options.states) {
+        TetrisGame::Snapshot state;
+        if (!game.snapshot(state)) {
+            return {};
+        }
+        states.push_back(state);
+        if (game.is_clearing()) {
+            clock.advance(std::chrono::milliseconds(250));
+            (void)game.step_clear_animation();
+        } else if (game.is_game_over() || !autoplayer.plan(game, plan)) {
+            game.start(++seed);
+        } else {
+            for (int i = 0; i < plan.size; ++i) {
+                (void)game.perform_action(plan.actions[i]);
+            }
+        }
+    }
+    return states;
+}
+
+std::uint64_t fnv1a(std::uint64_t hash, const unsigned char* data, std::size_t size) {
+    for (std::size_t i = 0; i < size; ++i) {
+        hash = (hash ^ data[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+template <typename T>
+T percentile(const std::vector<T>& sorted, double fraction) {
+    auto index = static_cast<std::size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+void print_timings(const char* label, Timings& timings) {
+    std::sort(timings.micros.begin(), timings.micros.end());
+    std::printf("  %-8s %9.1f fps, p50 %7.1f us, p90 %7.1f us, p99 %7.1f us\n",
+                label,
+                static_cast<double>(timings.micros.size()) / timings.seconds,
+                percentile(timings.micros, 0.5),
+                percentile(timings.micros, 0.9),
+                percentile(timings.micros, 0.99));
+}
+
+// Rows of the settled stack that are hidden while a clear flashes off.
+std::uint32_t hidden_rows(const TetrisGame& game) {
+    std::uint32_t rows = 0;
+    if (game.is_clearing() && !game.flash_visible()) {
+        for (int row : game.clearing_rows()) {
+            rows |= 1u << row;
+        }
+    }
+    return rows;
+}
+
+// "full" paints every frame with a fresh renderer, as on the first expose.
+// "update" keeps one renderer across the states, marks stale only the
+// settled rows that changed since the previous state, as the frontend does
+// from events, and repaints the frame as four clipped exposes split at a
+// point that moves between frames and rarely falls on a cell boundary.
+// Both must produce the same pixels; the checksum covers the full frames.
+BenchResult bench_block_size(const std::vector<TetrisGame::Snapshot>& states, int block_size) {
+    TetrisGame view;
+    BoardRenderer renderer(view, block_size);
+    const int width = TetrisGame::WIDTH * block_size;
+    const int height = TetrisGame::HEIGHT * block_size;
+    cairo_surface_t* surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
+    cairo_t* cr = cairo_create(surface);
+    cairo_surface_t* reference = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
+    cairo_t* reference_cr = cairo_create(reference);
+    const BoardRenderer::Area area{0, 0, width, height};
+
+    Timings full;
+    Timings update;
+    BenchResult result{0xCBF29CE484222325ull};
+    const auto size = static_cast<std::size_t>(cairo_image_surface_get_stride(surface)) * height;
+    TetrisGame::Board previous_board{};
+    std::uint32_t previous_hidden = 0;
+    int frame = 0;
+    for (const auto& state : states) {
+        if (!view.restore(state)) {
+            continue;
+        }
+        const auto active = view.active_cells();
+        const auto ghost = view.is_running() ? view.ghost_cells() : TetrisGame::Cells{};
+
+        auto begin = std::chrono::steady_clock::now();
+        {
+            BoardRenderer fresh(view, block_size);
+            BoardRenderer::fill_background(reference_cr, width, height);
+            fresh.render_board(reference_cr, area, active, ghost);
+        }
+        cairo_surface_flush(reference);
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        full.micros.push_back(elapsed * 1e6);
+        full.seconds += elapsed;
+
+        const auto& board = view.board();
+        const std::uint32_t hidden = hidden_rows(view);
+        std::uint32_t stale = previous_hidden ^ hidden;
+        for (int row = 0; row < TetrisGame::HEIGHT; ++row) {
+            if (board[row] != previous_board[row]) {
+                stale |= 1u << row;
+            }
+        }
+        previous_board = board;
+        previous_hidden = hidden;
+        const int split_x = (frame * 37) % width;
+        const int split_y = (frame * 53) % height;
+        frame++;
+        const BoardRenderer::Area exposes[] = {{0, 0, split_x, split_y},
+                                               {split_x, 0, width - split_x, split_y},
+                                               {0, split_y, split_x, height - split_y},
+                                               {split_x, split_y, width - split_x, height - split_y}};
+        begin = std::chrono::steady_clock::now();
+        renderer.mark_settled_stale(stale);
+        for (const auto& expose : exposes) {
+            if (expose.width == 0 || expose.height == 0) {
+                continue;
+            }
+            cairo_save(cr);
+            cairo_rectangle(cr, expose.x, expose.y, expose.width, expose.height);
+            cairo_clip(cr);
+            BoardRenderer::fill_background(cr, width, height);
+            renderer.render_board(cr, expose, active, ghost);
+            cairo_restore(cr);
+        }
+        cairo_surface_flush(surface);
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        update.micros.push_back(elapsed * 1e6);
+        update.seconds += elapsed;
+
+        const auto* expected = cairo_image_surface_get_data(reference);
+        result.checksum = fnv1a(result.checksum, expected, size);
+        if (fnv1a(0xCBF29CE484222325ull, cairo_image_surface_get_data(surface), size) !=
+            fnv1a(0xCBF29CE484222325ull, expected, size)) {
+            result.mismatches++;
+        }
+    }
+    cairo_destroy(reference_cr);
+    cairo_surface_destroy(reference);
+    cairo_destroy(cr);
+    cairo_surface_destroy(surface);
+
+    if (full.micros.empty()) {
+        return result;
+    }
+    std::printf("block %d px (%dx%d), checksum %016llx, %zu update mismatches\n",
+                block_size,
+                width,
+                height,
+                static_cast<unsigned long long>(result.checksum),
+                result.mismatches);
+    print_timings("full", full);
+    print_timings("update", update);
+    return result;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    auto states = record_states(options);
+    if (states.empty()) {
+        std::fprintf(stderr, "Cannot snapshot the game\n");
+        return EXIT_FAILURE;
+    }
+    std::printf("%zu board states from seed %u\n", states.size(), options.seed);
+    std::uint64_t checksum = 0xCBF29CE484222325ull;
+    std::size_t mismatches = 0;
+    for (int block_size : options.block_sizes) {
+        auto result = bench_block_size(states, block_size);
+        checksum = fnv1a(checksum, reinterpret_cast<const unsigned char*>(&result.checksum), sizeof(result.checksum));
+        mismatches += result.mismatches;
+    }
+    std::printf("checksum %016llx\n", static_cast<unsigned long long>(checksum));
+    if (mismatches != 0) {
+        std::fprintf(stderr, "%zu updated frames differ from a full paint\n", mismatches);
+        return EXIT_FAILURE;
+    }
+    if (options.has_expected && checksum != options.expected) {
+        std::fprintf(stderr,
+                     "checksum differs from the expected %016llx\n",
+                     static_cast<unsigned long long>(options.expected));
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,93 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "game_clock.hpp"
+#include "replay.hpp"
+#include "tetris_game.hpp"
+
+namespace {
+
+void print_usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " REPLAY...\n"
+              << "       " << argv0 << " --generate PATH SEED\n";
+}
+
+// Records a game driven by random inputs, for seeding regression suites
+// on machines without a device attached.
+int generate(const std::string& path, std::uint32_t seed) {
+    ManualGameClock clock;
+    TetrisGame game(seed, clock);
+    ReplayRecorder recorder;
+    game.set_recorder(&recorder);
+    game.start(seed);
+
+    std::mt19937 input_rng(seed);
+    std::uniform_int_distribution<int> action_dist(0, static_cast<int>(TetrisGame::Action::RotateCCW));
+    while (!game.is_game_over()) {
+        while (game.is_clearing()) {
+            clock.advance(TetrisGame::clear_duration());
+            (void)game.step_clear_animation();
+        }
+        (void)game.perform_action(static_cast<TetrisGame::Action>(action_dist(input_rng)));
+        (void)game.tick();
+    }
+
+    if (!recorder.save(path, game)) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << path << ": seed " << seed << ", score " << game.score() << ", lines " << game.lines() << std::endl;
+    return EXIT_SUCCESS;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (std::string(argv[1]) == "--generate") {
+        if (argc != 4) {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        return generate(argv[2], static_cast<std::uint32_t>(std::strtoul(argv[3], nullptr, 10)));
+    }
+
+    Replay replay;
+    ReplayPlayer player;
+    int failed = 0;
+    std::uint64_t events = 0;
+    std::chrono::steady_clock::duration elapsed{};
+
+    for (int i = 1; i < argc; ++i) {
+        if (!load_replay(argv[i], replay)) {
+            std::cerr << argv[i] << ": unreadable replay" << std::endl;
+            failed++;
+            continue;
+        }
+        auto begin = std::chrono::steady_clock::now();
+        ReplayResult result = player.play(replay);
+        elapsed += std::chrono::steady_clock::now() - begin;
+        events += result.ticks + result.actions;
+
+        if (!result.matched) {
+            std::cerr << argv[i] << ": expected score " << replay.score << " lines " << replay.lines
+                      << ", got score " << result.score << " lines " << result.lines << std::endl;
+            failed++;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    std::cout << (argc - 1) << " replays, " << failed << " failed, " << events << " events";
+    if (seconds > 0) {
+        std::cout << " (" << static_cast<std::uint64_t>(events / seconds) << " events/s)";
+    }
+    std::cout << std::endl;
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
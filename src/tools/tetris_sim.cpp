@@ -0,0 +1,300 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "autoplayer.hpp"
+#include "game_clock.hpp"
+#include "tetris_game.hpp"
+#include "thread_pool.hpp"
+#include "transposition_table.hpp"
+
+namespace {
+std::atomic<std::uint64_t> heap_allocations{0};
+}  // namespace
+
+// Counts every heap allocation in the process so --check-allocs can verify
+// that the game loop runs without touching the heap.
+void* operator new(std::size_t size) {
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size != 0 ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+namespace {
+
+struct Options {
+    std::size_t games = 1000;
+    std::size_t threads = 0;
+    std::uint32_t seed = 1;
+    long max_pieces = 10000;
+    bool random_driver = false;
+    bool check_allocs = false;
+    bool check_features = false;
+    std::size_t table_mb = 0;  // shared cache of depth-3 leaf values, 0 disables it
+    SearchConfig search;
+};
+
+struct alignas(64) Worker {
+    explicit Worker(const SearchConfig& search) : autoplayer(EvalWeights{}, search) {}
+
+    ManualGameClock clock;
+    TetrisGame game{0, clock};
+    std::mt19937 input_rng;
+    Autoplayer autoplayer;
+    Autoplayer::Plan plan;
+};
+
+struct GameResult {
+    long score = 0;
+    int lines = 0;
+};
+
+void print_usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [--games N] [--threads N] [--seed N] [--max-pieces N] [--driver ai|random]\n"
+              << "       [--depth 1-3] [--beam N] [--tucks 0|1] [--table-mb N]\n"
+              << "       " << argv0 << " --check-allocs [--seed N] [--max-pieces N] [--driver ai|random] [--depth 1-3]\n"
+              << "       " << argv0 << " --check-features [--games N] [--seed N] [--max-pieces N] [--driver ai|random]\n";
+}
+
+bool parse_options(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--check-allocs") == 0) {
+            options.check_allocs = true;
+            continue;
+        }
+        if (std::strcmp(argv[i], "--check-features") == 0) {
+            options.check_features = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        if (std::strcmp(argv[i], "--driver") == 0) {
+            options.random_driver = std::strcmp(argv[i + 1], "random") == 0;
+            if (!options.random_driver && std::strcmp(argv[i + 1], "ai") != 0) {
+                return false;
+            }
+            ++i;
+            continue;
+        }
+        unsigned long value = std::strtoul(argv[i + 1], nullptr, 10);
+        if (std::strcmp(argv[i], "--games") == 0) {
+            options.games = value;
+        } else if (std::strcmp(argv[i], "--threads") == 0) {
+            options.threads = value;
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            options.seed = static_cast<std::uint32_t>(value);
+        } else if (std::strcmp(argv[i], "--max-pieces") == 0) {
+            options.max_pieces = static_cast<long>(value);
+        } else if (std::strcmp(argv[i], "--depth") == 0) {
+            options.search.depth = static_cast<int>(value);
+        } else if (std::strcmp(argv[i], "--beam") == 0) {
+            options.search.beam_width = static_cast<int>(value);
+        } else if (std::strcmp(argv[i], "--table-mb") == 0) {
+            options.table_mb = value;
+        } else if (std::strcmp(argv[i], "--tucks") == 0) {
+            options.search.tucks = value != 0;
+        } else {
+            return false;
+        }
+        ++i;
+    }
+    return true;
+}
+
+// Finishes a line clear, or plays one random input and tick, or one
+// autoplayer placement. Returns false when the autoplayer has no move.
+bool advance(Worker& worker, const Options& options) {
+    auto& game = worker.game;
+    if (game.is_clearing()) {
+        worker.clock.advance(TetrisGame::clear_duration());
+        (void)game.step_clear_animation();
+        return true;
+    }
+    if (options.random_driver) {
+        std::uniform_int_distribution<int> action_dist(0, static_cast<int>(TetrisGame::Action::RotateCCW));
+        (void)game.perform_action(static_cast<TetrisGame::Action>(action_dist(worker.input_rng)));
+        (void)game.tick();
+        return true;
+    }
+    if (!worker.autoplayer.plan(game, worker.plan)) {
+        return false;
+    }
+    for (int i = 0; i < worker.plan.size; ++i) {
+        (void)game.perform_action(worker.plan.actions[i]);
+    }
+    return true;
+}
+
+// Game i always uses seed + i, so results do not depend on which worker
+// happened to run it.
+GameResult play_game(Worker& worker, std::uint32_t seed, const Options& options) {
+    auto& game = worker.game;
+    worker.input_rng.seed(seed);
+    game.start(seed);
+    while (!game.is_game_over() && game.pieces_placed() < options.max_pieces && advance(worker, options)) {
+    }
+    return {game.score(), game.lines()};
+}
+
+// Plays one game to warm up every buffer, then a second one while also
+// draining events and making the queries the renderer makes each frame, and
+// fails if the second game allocated anything.
+int check_allocations(const Options& options) {
+    auto worker = std::make_unique<Worker>(options.search);
+    (void)play_game(*worker, options.seed, options);
+
+    auto& game = worker->game;
+    std::size_t queried = 0;
+    std::size_t events = 0;
+    GameEvent event{};
+    std::uint64_t before = heap_allocations.load();
+    game.start(options.seed + 1);
+    while (!game.is_game_over() && game.pieces_placed() < options.max_pieces) {
+        while (game.events().pop(event)) {
+            events++;
+        }
+        queried += game.active_cells().size() + game.next_cells().size() + game.clearing_rows().size();
+        if (!advance(*worker, options)) {
+            break;
+        }
+    }
+    std::uint64_t allocations = heap_allocations.load() - before;
+
+    std::cout << "pieces: " << game.pieces_placed() << ", lines: " << game.lines() << ", events: " << events
+              << ", cells queried: " << queried
+              << "\nheap allocations in the game loop: " << allocations << std::endl;
+    return allocations == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Compares the features the engine keeps up to date in its BoardProfile
+// with a count from scratch after every event that changed the stack,
+// including the game-over fill and the reset of the next game.
+int check_features(const Options& options) {
+    auto worker = std::make_unique<Worker>(options.search);
+    auto& game = worker->game;
+    std::size_t checks = 0;
+    std::size_t mismatches = 0;
+    auto verify = [&]() {
+        bool changed = game.events().take_overflow();
+        GameEvent event{};
+        while (game.events().pop(event)) {
+            changed = changed || event.type == GameEvent::Type::PieceLocked ||
+                      event.type == GameEvent::Type::RowsCleared || event.type == GameEvent::Type::BoardFilled;
+        }
+        if (changed) {
+            checks++;
+            mismatches += !(game.profile().features() == Autoplayer::measure(game.occupancy()));
+        }
+    };
+    for (std::size_t index = 0; index < options.games; ++index) {
+        auto seed = options.seed + static_cast<std::uint32_t>(index);
+        worker->input_rng.seed(seed);
+        game.start(seed);
+        verify();
+        while (game.pieces_placed() < options.max_pieces) {
+            if (game.is_game_over_animating()) {
+                (void)game.step_clear_animation();
+            } else if (game.is_game_over() || !advance(*worker, options)) {
+                break;
+            }
+            verify();
+        }
+    }
+    std::cout << "games: " << options.games << ", feature checks: " << checks << ", mismatches: " << mismatches
+              << std::endl;
+    return mismatches == 0 && checks > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+template <typename T>
+T percentile(const std::vector<T>& sorted, double fraction) {
+    auto index = static_cast<std::size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parse_options(argc, argv, options) || options.games == 0) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (options.check_allocs) {
+        return check_allocations(options);
+    }
+    if (options.check_features) {
+        return check_features(options);
+    }
+
+    WorkStealingPool pool(options.threads);
+    std::unique_ptr<TranspositionTable> table;
+    if (options.table_mb != 0) {
+        table = std::make_unique<TranspositionTable>(options.table_mb);
+    }
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (std::size_t i = 0; i < pool.size(); ++i) {
+        workers.push_back(std::make_unique<Worker>(options.search));
+        workers.back()->autoplayer.set_table(table.get());
+    }
+
+    std::vector<GameResult> results(options.games);
+    std::atomic<std::uint64_t> total_pieces{0};
+
+    auto begin = std::chrono::steady_clock::now();
+    pool.parallel_for(options.games, 8, [&](std::size_t index, std::size_t worker_index) {
+        auto& worker = *workers[worker_index];
+        results[index] = play_game(worker, options.seed + static_cast<std::uint32_t>(index), options);
+        total_pieces.fetch_add(static_cast<std::uint64_t>(worker.game.pieces_placed()), std::memory_order_relaxed);
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    std::uint64_t placements = 0;
+    std::uint64_t table_hits = 0;
+    for (const auto& worker : workers) {
+        placements += worker->autoplayer.placements_evaluated();
+        table_hits += worker->autoplayer.table_hits();
+    }
+
+    std::vector<long> scores(results.size());
+    std::vector<int> lines(results.size());
+    std::transform(results.begin(), results.end(), scores.begin(), [](const GameResult& r) { return r.score; });
+    std::transform(results.begin(), results.end(), lines.begin(), [](const GameResult& r) { return r.lines; });
+    std::sort(scores.begin(), scores.end());
+    std::sort(lines.begin(), lines.end());
+    double mean_score = std::accumulate(scores.begin(), scores.end(), 0.0) / static_cast<double>(scores.size());
+    double mean_lines = std::accumulate(lines.begin(), lines.end(), 0.0) / static_cast<double>(lines.size());
+
+    std::cout << "games: " << options.games << ", threads: " << pool.size() << ", elapsed: " << seconds << " s\n"
+              << "games/sec: " << static_cast<double>(options.games) / seconds
+              << ", pieces/sec: " << static_cast<double>(total_pieces.load()) / seconds
+              << ", placements evaluated/sec: " << static_cast<double>(placements) / seconds << "\n"
+              << "score: mean " << mean_score << ", min " << scores.front() << ", p50 " << percentile(scores, 0.5)
+              << ", p90 " << percentile(scores, 0.9) << ", p99 " << percentile(scores, 0.99) << ", max "
+              << scores.back() << "\n"
+              << "lines: mean " << mean_lines << ", p50 " << percentile(lines, 0.5) << ", max " << lines.back()
+              << std::endl;
+    if (table) {
+        std::cout << "leaf cache: " << table->slots() << " slots, " << table_hits << " hits" << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
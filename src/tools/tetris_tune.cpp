@@ -0,0 +1,263 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "autoplayer.hpp"
+#include "game_clock.hpp"
+#include "tetris_game.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+
+constexpr std::size_t genes = 5;
+using Genome = std::array<double, genes>;
+
+struct Options {
+    std::size_t population = 32;
+    std::size_t generations = 20;
+    std::size_t games = 8;  // per individual, same seeds for everyone
+    std::size_t threads = 0;
+    std::uint32_t seed = 1;
+    long max_pieces = 500;
+    std::size_t elites = 2;
+    double mutation = 0.2;
+    std::string out = "weights.txt";
+    std::string init;
+    SearchConfig search;
+};
+
+struct alignas(64) Worker {
+    explicit Worker(const SearchConfig& search) : autoplayer(EvalWeights{}, search) {}
+
+    ManualGameClock clock;
+    TetrisGame game{0, clock};
+    Autoplayer autoplayer;
+    Autoplayer::Plan plan;
+};
+
+struct Individual {
+    Genome genome{};
+    double fitness = 0.0;
+};
+
+void print_usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [--population N] [--generations N] [--games N] [--max-pieces N]\n"
+              << "       [--threads N] [--seed N] [--elites N] [--mutation SIGMA] [--depth 1-3] [--beam N]\n"
+              << "       [--init WEIGHTS] [--out WEIGHTS]\n";
+}
+
+bool parse_options(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const char* arg = argv[i + 1];
+        unsigned long value = std::strtoul(arg, nullptr, 10);
+        if (std::strcmp(argv[i], "--population") == 0) {
+            options.population = value;
+        } else if (std::strcmp(argv[i], "--generations") == 0) {
+            options.generations = value;
+        } else if (std::strcmp(argv[i], "--games") == 0) {
+            options.games = value;
+        } else if (std::strcmp(argv[i], "--threads") == 0) {
+            options.threads = value;
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            options.seed = static_cast<std::uint32_t>(value);
+        } else if (std::strcmp(argv[i], "--max-pieces") == 0) {
+            options.max_pieces = static_cast<long>(value);
+        } else if (std::strcmp(argv[i], "--elites") == 0) {
+            options.elites = value;
+        } else if (std::strcmp(argv[i], "--mutation") == 0) {
+            options.mutation = std::strtod(arg, nullptr);
+        } else if (std::strcmp(argv[i], "--depth") == 0) {
+            options.search.depth = static_cast<int>(value);
+        } else if (std::strcmp(argv[i], "--beam") == 0) {
+            options.search.beam_width = static_cast<int>(value);
+        } else if (std::strcmp(argv[i], "--init") == 0) {
+            options.init = arg;
+        } else if (std::strcmp(argv[i], "--out") == 0) {
+            options.out = arg;
+        } else {
+            return false;
+        }
+        ++i;
+    }
+    return options.population >= 2 && options.games > 0 && options.elites < options.population;
+}
+
+Genome to_genome(const EvalWeights& weights) {
+    return {weights.aggregate_height, weights.lines, weights.holes, weights.bumpiness, weights.wells};
+}
+
+EvalWeights to_weights(const Genome& genome) {
+    return {genome[0], genome[1], genome[2], genome[3], genome[4]};
+}
+
+// Placement choice only depends on the direction of the weight vector, so
+// every genome is kept at unit length.
+void normalize(Genome& genome) {
+    double length = std::sqrt(std::inner_product(genome.begin(), genome.end(), genome.begin(), 0.0));
+    if (length == 0.0) {
+        genome[0] = -1.0;
+        return;
+    }
+    for (double& gene : genome) {
+        gene /= length;
+    }
+}
+
+// Fitness is the game's own score, so line-clear bonuses and level
+// multipliers are rewarded exactly as a player would be.
+long play_game(Worker& worker, std::uint32_t seed, long max_pieces) {
+    auto& game = worker.game;
+    game.start(seed);
+    while (!game.is_game_over() && game.pieces_placed() < max_pieces) {
+        if (game.is_clearing()) {
+            worker.clock.advance(TetrisGame::clear_duration());
+            (void)game.step_clear_animation();
+            continue;
+        }
+        if (!worker.autoplayer.plan(game, worker.plan)) {
+            break;
+        }
+        for (int i = 0; i < worker.plan.size; ++i) {
+            (void)game.perform_action(worker.plan.actions[i]);
+        }
+    }
+    return game.score();
+}
+
+const Individual& tournament(const std::vector<Individual>& population, std::mt19937& rng) {
+    std::uniform_int_distribution<std::size_t> pick(0, population.size() - 1);
+    const Individual* best = &population[pick(rng)];
+    for (int round = 1; round < 3; ++round) {
+        const Individual& challenger = population[pick(rng)];
+        if (challenger.fitness > best->fitness) {
+            best = &challenger;
+        }
+    }
+    return *best;
+}
+
+// Fitness-weighted blend of two parents followed by gaussian mutation.
+Genome breed(const Individual& a, const Individual& b, double sigma, std::mt19937& rng) {
+    double total = a.fitness + b.fitness;
+    double share = total > 0.0 ? a.fitness / total : 0.5;
+    std::normal_distribution<double> noise(0.0, sigma);
+    std::bernoulli_distribution mutate(0.3);
+    Genome child{};
+    for (std::size_t gene = 0; gene < genes; ++gene) {
+        child[gene] = share * a.genome[gene] + (1.0 - share) * b.genome[gene];
+        if (mutate(rng)) {
+            child[gene] += noise(rng);
+        }
+    }
+    normalize(child);
+    return child;
+}
+
+void print_genome(const Genome& genome) {
+    const char* separator = "";
+    for (double gene : genome) {
+        std::cout << separator << gene;
+        separator = " ";
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    EvalWeights start;
+    if (!options.init.empty() && !load_weights(options.init, start)) {
+        std::cerr << "Cannot read weights from " << options.init << "\n";
+        return EXIT_FAILURE;
+    }
+
+    WorkStealingPool pool(options.threads);
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (std::size_t i = 0; i < pool.size(); ++i) {
+        workers.push_back(std::make_unique<Worker>(options.search));
+    }
+
+    std::mt19937 rng(options.seed);
+    std::vector<Individual> population(options.population);
+    std::vector<Individual> next(options.population);
+    population[0].genome = to_genome(start);
+    normalize(population[0].genome);
+    std::normal_distribution<double> spread(0.0, 0.5);
+    for (std::size_t i = 1; i < population.size(); ++i) {
+        for (std::size_t gene = 0; gene < genes; ++gene) {
+            population[i].genome[gene] = population[0].genome[gene] + spread(rng);
+        }
+        normalize(population[i].genome);
+    }
+
+    const std::size_t evaluations = options.population * options.games;
+    std::vector<long> scores(evaluations);
+    Individual best;
+    best.fitness = -1.0;
+
+    for (std::size_t generation = 0; generation < options.generations; ++generation) {
+        auto begin = std::chrono::steady_clock::now();
+        pool.parallel_for(evaluations, 1, [&](std::size_t index, std::size_t worker_index) {
+            auto& worker = *workers[worker_index];
+            std::size_t individual = index / options.games;
+            std::size_t game = index % options.games;
+            worker.autoplayer.set_weights(to_weights(population[individual].genome));
+            scores[index] = play_game(worker, options.seed + static_cast<std::uint32_t>(game), options.max_pieces);
+        });
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        double population_total = 0.0;
+        for (std::size_t i = 0; i < population.size(); ++i) {
+            auto first = scores.begin() + static_cast<std::ptrdiff_t>(i * options.games);
+            double total = std::accumulate(first, first + static_cast<std::ptrdiff_t>(options.games), 0.0);
+            population[i].fitness = total / static_cast<double>(options.games);
+            population_total += population[i].fitness;
+        }
+        // Stable so equal fitness keeps the earlier index and runs stay reproducible.
+        std::stable_sort(population.begin(), population.end(), [](const Individual& a, const Individual& b) {
+            return a.fitness > b.fitness;
+        });
+        if (population.front().fitness > best.fitness) {
+            best = population.front();
+            if (!save_weights(options.out, to_weights(best.genome))) {
+                std::cerr << "Cannot write weights to " << options.out << "\n";
+                return EXIT_FAILURE;
+            }
+        }
+
+        std::cout << "generation " << generation << ": best " << population.front().fitness << ", mean "
+                  << population_total / static_cast<double>(population.size()) << ", games/sec "
+                  << static_cast<double>(evaluations) / seconds << ", weights ";
+        print_genome(population.front().genome);
+        std::cout << std::endl;
+
+        std::copy_n(population.begin(), options.elites, next.begin());
+        for (std::size_t i = options.elites; i < next.size(); ++i) {
+            const Individual& a = tournament(population, rng);
+            const Individual& b = tournament(population, rng);
+            next[i].genome = breed(a, b, options.mutation, rng);
+        }
+        population.swap(next);
+    }
+
+    std::cout << "best fitness " << best.fitness << " written to " << options.out << std::endl;
+    return EXIT_SUCCESS;
+}